@@ -140,6 +140,35 @@ pub fn buildBenchmarks(b: *std.build.Builder, target: std.zig.CrossTarget) void
     buildBenchmarksZentt(b, target);
 }
 
+/// Simulation without window or renderer, for load testing the game systems.
+/// The Vulkan bindings are still needed because the asset database refers to them, but they are never loaded.
+pub fn buildHeadless(b: *std.build.Builder, target: std.zig.CrossTarget, mode: std.builtin.Mode, options: *std.build.OptionsStep, vk_package: std.build.Pkg) void {
+    const exe = b.addExecutable("zentt-headless", "src/headless.zig");
+    exe.addOptions("build_options", options);
+    exe.addPackage(vk_package);
+
+    // stb
+    exe.addIncludeDir("libs/stb");
+    exe.addCSourceFiles(
+        &.{"libs/stb/stb_image.c"},
+        &.{},
+    );
+
+    exe.linkLibC();
+    exe.setTarget(target);
+    exe.setBuildMode(mode);
+    exe.install();
+
+    const run_cmd = exe.run();
+    run_cmd.step.dependOn(b.getInstallStep());
+    if (b.args) |args| {
+        run_cmd.addArgs(args);
+    }
+
+    const run_step = b.step("headless", "Run the game simulation without window and renderer");
+    run_step.dependOn(&run_cmd.step);
+}
+
 pub fn build(b: *std.build.Builder) void {
     // Standard target options allows the person running `zig build` to choose
     // what target to build for. Here we do not override the defaults, which
@@ -240,6 +269,8 @@ pub fn build(b: *std.build.Builder) void {
     const gen = vkgen.VkGenerateStep.init(b, vk_xml_path, "vk.zig");
     exe.addPackage(gen.package);
 
+    buildHeadless(b, target, mode, options, gen.package);
+
     const res = ResourceGenStep.init(b, "resources.zig");
     res.addShader("triangle_vert", "src/rendering/vulkan/shaders/triangle.vert");
     res.addShader("triangle_frag", "src/rendering/vulkan/shaders/triangle.frag");
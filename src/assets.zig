@@ -1,6 +1,7 @@
 const std = @import("std");
 
 const AssetDB = @import("rendering/assetdb.zig");
+const Vec2 = @import("math.zig").Vec2;
 
 pub fn loadAssets(assetdb: *AssetDB) !void {
     try assetdb.loadTexturePack("assets/img/characters.json", .{ .filter = .nearest });
@@ -10,6 +11,11 @@ pub fn loadAssets(assetdb: *AssetDB) !void {
     try assetdb.loadTexturePack("assets/img/UI.json", .{ .filter = .nearest });
     try assetdb.loadTexturePack("assets/tilesets/ForestTexturePacked.json", .{ .filter = .nearest });
 
+    // Game systems only look up textures with `findTextureByPath`, so they have to be loaded here.
+    _ = try assetdb.getTextureByPath("HolyBook.png", .{});
+    _ = try assetdb.getTextureByPath("Axe.png", .{});
+    _ = try assetdb.getTextureByPath("Gem1.png", .{});
+
     // Items
     // ArmorIron.png
     // Axe.png
@@ -495,3 +501,16 @@ pub fn loadAssets(assetdb: *AssetDB) !void {
     _ = try assetdb.defineSpriteAnimationFromInTexturePack("Suora", 2, "Suora_");
     _ = try assetdb.defineSpriteAnimationFromInTexturePack("0x00000000", 2, "_0x00000000_i");
 }
+
+/// Defines placeholders for every asset the game systems use, for running them without a GPU.
+pub fn loadPlaceholderAssets(assetdb: *AssetDB) !void {
+    const size = Vec2.new(32, 32);
+
+    _ = try assetdb.definePlaceholderTexture("HolyBook.png", size);
+    _ = try assetdb.definePlaceholderTexture("Axe.png", size);
+    _ = try assetdb.definePlaceholderTexture("Gem1.png", size);
+
+    _ = try assetdb.definePlaceholderSpriteAnimation("Antonio", 2, size);
+    _ = try assetdb.definePlaceholderSpriteAnimation("Bat1", 2, size);
+    _ = try assetdb.definePlaceholderSpriteAnimation("Bat1i", 2.5, size);
+}
@@ -24,6 +24,7 @@ const Query = @import("ecs/query.zig").Query;
 const Tag = @import("ecs/tag_component.zig").Tag;
 const Chunk = @import("ecs/chunk.zig");
 const Commands = @import("ecs/commands.zig");
+const WorldRunner = @import("ecs/world_runner.zig");
 
 pub const query_track_iter_invalidation = true;
 
@@ -46,7 +47,10 @@ pub fn main() !void {
     try createEntitiesAddFiveEmptyComps(allocator, iterations, entity_count);
     try createEntitiesAddFiveEmptyCompsBundle(allocator, iterations, entity_count);
 
+    try firstSpawnIntoNewArchetype(allocator, iterations, entity_count);
+
     try addComponent(allocator, iterations, entity_count);
+    try addComponentToAll(allocator, iterations, entity_count);
 
     try commandsCreateEntity(allocator, iterations, entity_count);
     try commandsCreateEntityEightComps(allocator, iterations, entity_count);
@@ -57,8 +61,14 @@ pub fn main() !void {
     try iterEntitiesOneComp(allocator, iterations, entity_count);
     try iterEntitiesEightCompsUseThree(allocator, iterations, entity_count);
     try iterEntitiesEightCompsUseAll(allocator, iterations, entity_count);
-    try iterEntitiesFiveCompsDifferentCombsUseTwo(allocator, iterations, entity_count);
+    try iterEntitiesFiveCompsDifferentCombsUseTwo(allocator, iterations, entity_count, false);
+    try iterEntitiesFiveCompsDifferentCombsUseTwo(allocator, iterations, entity_count, true);
     try iterEntitiesFiveCompsDifferentCombsUseTwo2(allocator, iterations, entity_count);
+
+    try parallelWrite(allocator, iterations, entity_count, false);
+    try parallelWrite(allocator, iterations, entity_count, true);
+
+    try parallelWorlds(allocator, iterations, entity_count / 10);
 }
 
 const PositionComponent = struct {
@@ -349,6 +359,57 @@ pub fn createEntitiesAddFiveEmptyCompsBundle(allocator: std.mem.Allocator, itera
     t.printAvgStats();
 }
 
+pub fn firstSpawnIntoNewArchetype(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
+    std.debug.print("  Spawn first entity with eight components into a new world, then {} more\n", .{entity_count});
+
+    var first_timer = Timer{};
+    var slowest = RunningMean{};
+
+    var k: u64 = 0;
+    while (k < iterations) : (k += 1) {
+        var world = try World.init(allocator);
+        defer world.deinit();
+
+        // Creates the archetype table and its first chunk.
+        first_timer.start();
+        _ = try world.createEntityBundle(&.{
+            PositionComponent{},
+            TestComp1{},
+            TestComp2{},
+            TestComp3{},
+            TestComp4{},
+            TestComp5{},
+            TestComp6{},
+            TestComp7{},
+        });
+        first_timer.end(1);
+
+        // The slowest spawn is the one which allocates the last (largest) chunk.
+        var slowest_ns: u64 = 0;
+        var timer = try std.time.Timer.start();
+        var i: usize = 1;
+        while (i < entity_count) : (i += 1) {
+            _ = timer.lap();
+            _ = try world.createEntityBundle(&.{
+                PositionComponent{},
+                TestComp1{},
+                TestComp2{},
+                TestComp3{},
+                TestComp4{},
+                TestComp5{},
+                TestComp6{},
+                TestComp7{},
+            });
+            slowest_ns = std.math.max(slowest_ns, timer.read());
+        }
+        slowest.update(@intToFloat(f64, slowest_ns) / std.time.ns_per_us);
+    }
+
+    first_timer.printAvgStats();
+    const slowest_result = slowest.get();
+    std.debug.print("  Slowest: {d:.2}us ({d:.2}, {d:.2})\n\n", .{ slowest_result.mean, slowest_result.std_dev, slowest_result.sample_std_dev });
+}
+
 pub fn addComponent(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
     std.debug.print("  Add one component to {} entities with 5 components\n", .{entity_count});
 
@@ -385,6 +446,37 @@ pub fn addComponent(allocator: std.mem.Allocator, iterations: u64, entity_count:
     t.printAvgStats();
 }
 
+pub fn addComponentToAll(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
+    std.debug.print("  Add one component to {} entities with 5 components at once\n", .{entity_count});
+
+    var world = try World.init(allocator);
+    defer world.deinit();
+
+    var t = Timer{};
+
+    var k: u64 = 0;
+    while (k < iterations) : (k += 1) {
+        try world.clear();
+
+        var i: usize = 0;
+        while (i < entity_count) : (i += 1) {
+            _ = try world.createEntityBundle(&.{
+                PositionComponent{},
+                TestComp1{},
+                TestComp2{},
+                TestComp3{},
+                TestComp4{},
+            });
+        }
+
+        t.start();
+        try world.addComponentToAll(.{PositionComponent}, TestComp7{});
+        t.end(entity_count);
+    }
+
+    t.printAvgStats();
+}
+
 pub fn commandsCreateEntity(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
     std.debug.print("  Run {} create entity commands. \n", .{entity_count});
 
@@ -678,12 +770,16 @@ pub fn iterEntitiesEightCompsUseAll(allocator: std.mem.Allocator, iterations: u6
     t.printAvgStats();
 }
 
-pub fn iterEntitiesFiveCompsDifferentCombsUseTwo(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
-    std.debug.print("  Iterate {} entities with five components, different combinations, use 2\n", .{entity_count});
+pub fn iterEntitiesFiveCompsDifferentCombsUseTwo(allocator: std.mem.Allocator, iterations: u64, entity_count: u64, grouped: bool) !void {
+    std.debug.print("  Iterate {} entities with five components, different combinations, use 2{s}\n", .{ entity_count, if (grouped) " (owning group)" else "" });
 
     var world = try World.init(allocator);
     defer world.deinit();
 
+    if (grouped) {
+        _ = try world.addGroup(.{ PositionComponent, DirectionComponent });
+    }
+
     var i: usize = 0;
     var x: u64 = 0;
     while (i < entity_count) : (i += 1) {
@@ -794,6 +890,196 @@ pub fn iterEntitiesFiveCompsDifferentCombsUseTwo2(allocator: std.mem.Allocator,
     t2.printAvgStats();
 }
 
+/// Threads write interleaved blocks of rows of every chunk. With blocks which don't end on cache line boundaries
+/// neighbouring blocks share cache lines, which shows the cost of false sharing.
+pub fn parallelWrite(allocator: std.mem.Allocator, iterations: u64, entity_count: u64, aligned: bool) !void {
+    const thread_count = 4;
+    const block_rows = 30;
+    std.debug.print("  Write {} entities from {} threads, {s} blocks of rows\n", .{ entity_count, thread_count, if (aligned) "cache line aligned" else "unaligned" });
+
+    var world = try World.init(allocator);
+    defer world.deinit();
+
+    var i: usize = 0;
+    while (i < entity_count) : (i += 1) {
+        _ = try world.createEntityBundle(.{ PositionComponent{}, DirectionComponent{ .x = 1, .y = 2 } });
+    }
+
+    // Threads are spawned once and wait for each iteration, so only the writes are timed.
+    const Workers = struct {
+        const Self = @This();
+
+        mutex: std.Thread.Mutex = .{},
+        start_condition: std.Thread.Condition = .{},
+        done_condition: std.Thread.Condition = .{},
+        generation: u64 = 0,
+        running: usize = 0,
+        quit: bool = false,
+
+        chunks: []const *Chunk = &[_]*Chunk{},
+        block_size_aligned: bool,
+
+        /// Every chunk is split into ranges of about `block_rows` rows, which are assigned to the threads round robin,
+        /// so neighbouring ranges are written by different threads.
+        fn writeBlocks(chunks: []const *Chunk, thread_index: u64, block_size_aligned: bool) void {
+            for (chunks) |chunk| {
+                const position_index = chunk.table.getListIndexForType(Rtti.typeId(PositionComponent)) orelse unreachable;
+                const direction_index = chunk.table.getListIndexForType(Rtti.typeId(DirectionComponent)) orelse unreachable;
+                const positions = std.mem.bytesAsSlice(PositionComponent, @alignCast(@alignOf(PositionComponent), chunk.getComponents(position_index).data));
+                const directions = std.mem.bytesAsSlice(DirectionComponent, @alignCast(@alignOf(DirectionComponent), chunk.getComponents(direction_index).data));
+
+                const range_count = thread_count * std.math.max(chunk.count / (block_rows * thread_count), 1);
+                var range_index = thread_index;
+                while (range_index < range_count) : (range_index += thread_count) {
+                    var start: u64 = undefined;
+                    var end: u64 = undefined;
+                    if (block_size_aligned) {
+                        const range = chunk.getRowRange(range_index, range_count);
+                        start = range.start;
+                        end = range.end;
+                    } else {
+                        const rows_per_range = (chunk.count + range_count - 1) / range_count;
+                        start = std.math.min(range_index * rows_per_range, chunk.count);
+                        end = std.math.min(start + rows_per_range, chunk.count);
+                    }
+
+                    for (positions[start..end]) |*position, k| {
+                        position.x += directions[start + k].x;
+                        position.y += directions[start + k].y;
+                    }
+                }
+            }
+        }
+
+        fn workerMain(self: *Self, thread_index: u64) void {
+            var generation: u64 = 0;
+            while (true) {
+                self.mutex.lock();
+                while (self.generation == generation and !self.quit) {
+                    self.start_condition.wait(&self.mutex);
+                }
+                if (self.quit) {
+                    self.mutex.unlock();
+                    return;
+                }
+                generation = self.generation;
+                const chunks = self.chunks;
+                self.mutex.unlock();
+
+                writeBlocks(chunks, thread_index, self.block_size_aligned);
+
+                self.mutex.lock();
+                self.running -= 1;
+                if (self.running == 0) {
+                    self.done_condition.signal();
+                }
+                self.mutex.unlock();
+            }
+        }
+
+        fn run(self: *Self, chunks: []const *Chunk) void {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+
+            self.chunks = chunks;
+            self.running = thread_count;
+            self.generation += 1;
+            self.start_condition.broadcast();
+            while (self.running > 0) {
+                self.done_condition.wait(&self.mutex);
+            }
+        }
+
+        fn stop(self: *Self, threads: []std.Thread) void {
+            self.mutex.lock();
+            self.quit = true;
+            self.start_condition.broadcast();
+            self.mutex.unlock();
+
+            for (threads) |thread| {
+                thread.join();
+            }
+        }
+    };
+
+    var workers = Workers{ .block_size_aligned = aligned };
+    var threads: [thread_count]std.Thread = undefined;
+    for (threads) |*thread, thread_index| {
+        thread.* = std.Thread.spawn(.{}, Workers.workerMain, .{ &workers, @as(u64, thread_index) }) catch |err| {
+            workers.stop(threads[0..thread_index]);
+            return err;
+        };
+    }
+    defer workers.stop(&threads);
+
+    var t = Timer{};
+
+    var k: u64 = 0;
+    while (k < iterations) : (k += 1) {
+        var query = try world.query(.{ PositionComponent, DirectionComponent });
+        defer query.deinit();
+
+        t.start();
+        workers.run(query.chunks);
+        t.end(entity_count);
+    }
+
+    t.printAvgStats();
+}
+
+fn parallelWorldsMoveSystem(query: Query(.{ PositionComponent, DirectionComponent })) !void {
+    var iter = query.iter();
+    while (iter.next()) |entity| {
+        entity.position.x += entity.direction.x;
+        entity.position.y += entity.direction.y;
+    }
+}
+
+pub fn parallelWorlds(allocator: std.mem.Allocator, iterations: u64, entity_count: u64) !void {
+    const cpu_count = try std.Thread.getCpuCount();
+    std.debug.print("  Step 1 to {} worlds with {} entities each in parallel\n", .{ cpu_count, entity_count });
+
+    var worlds = std.ArrayList(*World).init(allocator);
+    defer {
+        for (worlds.items) |world| {
+            world.deinit();
+        }
+        worlds.deinit();
+    }
+
+    var world_count: usize = 1;
+    while (world_count <= cpu_count) : (world_count *= 2) {
+        while (worlds.items.len < world_count) {
+            var world = try World.init(allocator);
+            errdefer world.deinit();
+            try world.addSystem(parallelWorldsMoveSystem, "Move");
+
+            var i: usize = 0;
+            while (i < entity_count) : (i += 1) {
+                _ = try world.createEntityBundle(.{ PositionComponent{}, DirectionComponent{ .x = 1, .y = 2 } });
+            }
+            try worlds.append(world);
+        }
+
+        var runner = try WorldRunner.init(allocator, worlds.items, world_count);
+        defer runner.deinit();
+
+        std.debug.print("  {} worlds\n", .{world_count});
+
+        var t = Timer{};
+
+        var k: u64 = 0;
+        while (k < iterations) : (k += 1) {
+            t.start();
+            try runner.step();
+            t.end(world_count * entity_count);
+        }
+
+        std.debug.print("  Rate:  {d:.2}M entities/s\n", .{1000 / t.iter.get().mean});
+        t.printAvgStats();
+    }
+}
+
 // Utilities
 
 inline fn black_box(value: anytype) @TypeOf(value) {
@@ -815,11 +1101,12 @@ const RunningMean = struct {
         self.m2 += delta * delta2;
     }
 
-    pub fn get(self: @This()) struct { mean: f64, variance: f64, sample_variance: f64 } {
+    /// Returns the mean and the standard deviation of the population and of the sample, in the unit of the values.
+    pub fn get(self: @This()) struct { mean: f64, std_dev: f64, sample_std_dev: f64 } {
         return .{
             .mean = self.mean,
-            .variance = @sqrt(self.m2 / self.count),
-            .sample_variance = @sqrt(self.m2 / (self.count - 1)),
+            .std_dev = @sqrt(self.m2 / self.count),
+            .sample_std_dev = @sqrt(self.m2 / (self.count - 1)),
         };
     }
 };
@@ -864,7 +1151,7 @@ const Timer = struct {
     pub fn printAvgStats(self: *@This()) void {
         const total_result = self.total.get();
         const iter_result = self.iter.get();
-        std.debug.print("  Total: {d:.2}ms ({d:.2}, {d:.2})\n", .{ total_result.mean, total_result.variance, total_result.sample_variance });
-        std.debug.print("  Iter:  {d:.2}ns ({d:.2}, {d:.2})\n\n", .{ iter_result.mean, iter_result.variance, iter_result.sample_variance });
+        std.debug.print("  Total: {d:.2}ms ({d:.2}, {d:.2})\n", .{ total_result.mean, total_result.std_dev, total_result.sample_std_dev });
+        std.debug.print("  Iter:  {d:.2}ns ({d:.2}, {d:.2})\n\n", .{ iter_result.mean, iter_result.std_dev, iter_result.sample_std_dev });
     }
 };
@@ -1,71 +1,49 @@
 const std = @import("std");
 
 const World = @import("world.zig");
-const ArchetypeTable = @import("archetype_table.zig");
 const BitSet = @import("../util/bit_set.zig");
 
+/// Cached `hashComponents(components)`.
 hash: u64,
 components: BitSet,
 world: *World,
 
 const Self = @This();
 
-pub fn init(world: *World, hash: u64, components: BitSet) Self {
+pub fn init(world: *World, components: BitSet) Self {
     return Self{
-        .hash = hash,
+        .hash = hashComponents(components),
         .components = components,
         .world = world,
     };
 }
 
+/// Mixes all bits of the component set (splitmix64 finalizer), so sets which differ in a single component
+/// end up far apart, unlike XOR-ing the hashes of the component types.
+pub fn hashComponents(components: BitSet) u64 {
+    var x: u64 = components.bitSet.mask;
+    x = (x ^ (x >> 30)) *% 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) *% 0x94d049bb133111eb;
+    x = x ^ (x >> 31);
+    return x;
+}
+
 pub fn clone(self: *const Self) !Self {
-    return Self.init(self.world, self.hash, self.components);
+    return self.*;
 }
 
-pub fn addComponents(self: *const Self, hash: u64, components: BitSet) Self {
+pub fn addComponents(self: *const Self, components: BitSet) Self {
     var newComponents = self.components;
     newComponents.setUnion(components);
-    return Self.init(self.world, self.hash ^ hash, newComponents);
+    return Self.init(self.world, newComponents);
 }
 
-pub fn removeComponents(self: *const Self, hash: u64, components: BitSet) Self {
+pub fn removeComponents(self: *const Self, components: BitSet) Self {
     var newComponents = self.components;
     newComponents.subtract(components);
-    return Self.init(self.world, self.hash ^ hash, newComponents);
+    return Self.init(self.world, newComponents);
 }
 
-pub const Context = struct {
-    pub fn hash(context: @This(), self: *const Self) u64 {
-        _ = context;
-        return self.hash;
-    }
-    pub fn eql(context: @This(), a: *const Self, b: *Self) bool {
-        _ = context;
-        if (a.hash != b.hash) {
-            return false;
-        }
-
-        const result = std.meta.eql(a.components, b.components);
-        return result;
-    }
-};
-
-pub const HashTableContext = struct {
-    pub fn hash(context: @This(), self: *const Self) u64 {
-        _ = context;
-        return self.hash;
-    }
-    pub fn eql(context: @This(), a: *const Self, b: *ArchetypeTable) bool {
-        _ = context;
-        if (a.hash != b.archetype.hash) {
-            return false;
-        }
-
-        const result = std.meta.eql(a.components, b.archetype.components);
-        return result;
-    }
-};
-
 pub fn format(self: *const Self, comptime fmt: []const u8, options: std.fmt.FormatOptions, writer: anytype) !void {
     _ = fmt;
     _ = options;
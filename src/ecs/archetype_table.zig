@@ -4,11 +4,17 @@ const Archetype = @import("archetype.zig");
 const Chunk = @import("chunk.zig");
 const Entity = @import("entity.zig");
 const EntityRef = Entity.Ref;
+const Group = @import("group.zig");
+const Stats = @import("stats.zig");
 
 const BitSet = @import("../util/bit_set.zig");
 const Rtti = @import("../util/rtti.zig");
 
-typeToList: std.AutoHashMap(Rtti.TypeId, u64),
+/// Column index in the chunks of this table for each component id, or `no_column` for components
+/// which don't have a column here (not in the archetype, zero sized or owned by the group).
+columns: [BitSet.capacity]i8 = [_]i8{no_column} ** BitSet.capacity,
+column_count: u64 = 0,
+
 supersets: std.AutoHashMap(BitSet, *Self),
 subsets: std.AutoHashMap(BitSet, *Self),
 archetype: Archetype,
@@ -16,21 +22,47 @@ archetype: Archetype,
 firstChunk: *Chunk,
 firstFreeChunk: ?*Chunk = null,
 
+/// Sum of the counts of all chunks, maintained by the chunks.
+entity_count: u64 = 0,
+/// Number of disabled rows in all chunks, included in `entity_count`.
+disabled_count: u64 = 0,
+
+/// Set if this table contains all components owned by a group.
+/// Those components are stored in the group instead of this table's chunks.
+group: ?*Group = null,
+
+/// True for the table a group stores its components in.
+/// Rows of this table are tracked in `entity.group_chunk/group_index`.
+is_group_storage: bool = false,
+
+/// Incremented whenever any chunk of this table changes structurally or a new chunk is added.
+version: u64 = 0,
+
+counters: Stats.TableCounters = .{},
+
 const Self = @This();
 
-pub fn init(self: *Self, archetype: Archetype, allocator: std.mem.Allocator) !void {
+const no_column: i8 = -1;
+
+/// Chunks are allocated with `chunk_allocator`, everything else with `allocator`.
+pub fn init(self: *Self, archetype: Archetype, group: ?*Group, allocator: std.mem.Allocator, chunk_allocator: std.mem.Allocator) !void {
     self.* = Self{
         .supersets = std.AutoHashMap(BitSet, *Self).init(allocator),
         .subsets = std.AutoHashMap(BitSet, *Self).init(allocator),
         .archetype = archetype,
-        .firstChunk = try Chunk.init(self, 100, allocator),
-        .typeToList = std.AutoHashMap(Rtti.TypeId, u64).init(allocator),
+        .firstChunk = undefined,
+        .group = group,
     };
-    var iter = archetype.components.iterator();
+    // The chunk layout depends on the group, so the chunk is created after all fields are set.
+    self.firstChunk = try Chunk.init(self, 100, chunk_allocator);
+    self.counters.recordChunk(self.firstChunk);
+    const stored_components = self.storedComponents();
+    var iter = stored_components.iterator();
     while (iter.next()) |componentId| {
         const componentType = archetype.world.getComponentType(componentId) orelse unreachable;
         if (componentType.typeInfo.size > 0) {
-            try self.typeToList.put(componentType, self.typeToList.count());
+            self.columns[componentId] = @intCast(i8, self.column_count);
+            self.column_count += 1;
         }
     }
 }
@@ -40,13 +72,38 @@ pub fn deinit(self: *Self) void {
     while (chunk) |c| {
         chunk = c.deinit();
     }
-    self.typeToList.deinit();
     self.supersets.deinit();
     self.subsets.deinit();
 }
 
+pub inline fn getColumnIndex(self: *const Self, component_id: u64) ?u64 {
+    const column = self.columns[component_id];
+    return if (column == no_column) null else @intCast(u64, column);
+}
+
 pub fn getListIndexForType(self: *const Self, rtti: Rtti.TypeId) ?u64 {
-    return self.typeToList.get(rtti);
+    const component_id = self.archetype.world.findComponentId(rtti) orelse return null;
+    return self.getColumnIndex(component_id);
+}
+
+/// Components which have a column in the chunks of this table.
+pub fn storedComponents(self: *const Self) BitSet {
+    if (self.group) |group| {
+        return self.archetype.components.without(group.components);
+    }
+    return self.archetype.components;
+}
+
+/// Returns the data of a sized component of an entity in this table,
+/// which is either stored in the entity's chunk or in the group of this table.
+pub fn getComponentRaw(self: *const Self, entity: *const Entity, component_id: u64) ?[]u8 {
+    if (self.getColumnIndex(component_id)) |index| {
+        return entity.chunk.getComponentRaw(index, entity.index);
+    }
+    if (self.group) |group| {
+        return group.getComponentRaw(entity, component_id);
+    }
+    return null;
 }
 
 pub fn updateFirstFreeChunk(self: *Self, chunk: *Chunk) void {
@@ -71,109 +128,152 @@ pub fn getNextFreeChunk(self: *Self) !*Chunk {
 }
 
 pub fn getEntityCount(self: *const Self) usize {
-    var count: usize = 0;
-    var chunk: ?*Chunk = self.firstChunk;
+    return self.entity_count;
+}
 
-    while (chunk) |c| {
-        count += c.count;
-        chunk = c.next;
+/// Number of rows which are visible to queries.
+pub fn getEnabledEntityCount(self: *const Self) usize {
+    return self.entity_count - self.disabled_count;
+}
+
+/// Adds a row for the entity to this table, and to the group of this table unless the entity is already in it.
+fn addRow(self: *Self, entity: *Entity, old_group: ?*Group) !void {
+    var free_chunk = try self.getNextFreeChunk();
+    try free_chunk.addEntity(entity);
+
+    if (self.group) |group| {
+        if (group != old_group) {
+            try group.addEntity(entity);
+        }
     }
+}
 
-    return count;
+/// Removes the row of an entity which was moved to `new_table`, or deleted if `new_table` is null.
+/// `old_entity` is a copy of the entity before it was moved.
+pub fn removeEntity(self: *Self, old_entity: *const Entity, new_table: ?*Self) void {
+    old_entity.chunk.removeEntity(old_entity.index);
+
+    if (self.group) |group| {
+        if (new_table == null or new_table.?.group != group) {
+            group.removeEntity(old_entity);
+        }
+    }
 }
 
 pub fn addEntity(self: *Self, entity: *Entity, components: anytype) !void {
     // @todo: check if the provided components match the archetype
-    var free_chunk = try self.getNextFreeChunk();
-    try free_chunk.addEntity(entity);
+    try self.addRow(entity, null);
 
     const ComponentsType = if (@typeInfo(@TypeOf(components)) == .Pointer) std.meta.Child(@TypeOf(components)) else @TypeOf(components);
 
     inline for (@typeInfo(ComponentsType).Struct.fields) |field| {
-        const componentType = Rtti.typeId(field.field_type);
-        const index = self.getListIndexForType(componentType) orelse unreachable;
-        try entity.chunk.setComponentRaw(index, entity.index, std.mem.asBytes(&@field(components, field.name)));
+        if (@sizeOf(field.field_type) > 0) {
+            const component_id = self.archetype.world.findComponentId(Rtti.typeId(field.field_type)) orelse unreachable;
+            const data = self.getComponentRaw(entity, component_id) orelse unreachable;
+            std.mem.copy(u8, data, std.mem.asBytes(&@field(components, field.name)));
+        }
     }
 }
 
 pub fn addEntityRaw(self: *Self, entity: *Entity, component_types: []const Rtti.TypeId, component_data: []const []const u8) !void {
     // @todo: check if the provided components match the archetype
     std.debug.assert(component_types.len == component_data.len);
-    var free_chunk = try self.getNextFreeChunk();
-    try free_chunk.addEntity(entity);
+    try self.addRow(entity, null);
 
     for (component_types) |component_type, i| {
         if (component_type.typeInfo.size > 0) {
-            const index = self.getListIndexForType(component_type) orelse unreachable;
-            try entity.chunk.setComponentRaw(index, entity.index, component_data[i]);
+            const component_id = self.archetype.world.findComponentId(component_type) orelse unreachable;
+            const data = self.getComponentRaw(entity, component_id) orelse unreachable;
+            std.mem.copy(u8, data, component_data[i]);
+        }
+    }
+}
+
+/// Copies all components this table has from the old location of the entity.
+/// Components owned by a group which both tables belong to are not moved.
+fn copyComponentsFrom(self: *Self, entity: *Entity, old_entity: *const Entity) void {
+    const old_table = old_entity.chunk.table;
+
+    for (entity.chunk.components) |*component_list| {
+        if (old_table.getComponentRaw(old_entity, component_list.component_id)) |old_data| {
+            component_list.setRaw(entity.index, old_data);
+        }
+    }
+
+    if (self.group) |group| {
+        if (group != old_table.group) {
+            for (entity.group_chunk.components) |*component_list| {
+                if (old_table.getComponentRaw(old_entity, component_list.component_id)) |old_data| {
+                    component_list.setRaw(entity.group_index, old_data);
+                }
+            }
         }
     }
 }
 
+/// The caller has to remove the entity from its old table afterwards using `removeEntity`.
 pub fn copyEntityWithComponentIntoRaw(self: *Self, entity: *Entity, componentType: Rtti.TypeId, componentData: []const u8) !void {
     // @todo: check if the provided components match the archetype
 
     const old_entity = entity.*;
 
     // Add entity
-    var free_chunk = try self.getNextFreeChunk();
-    try free_chunk.addEntity(entity);
+    try self.addRow(entity, old_entity.chunk.table.group);
 
     // Add new component
-    std.debug.assert(self.typeToList.count() == entity.chunk.components.len);
+    std.debug.assert(self.column_count == entity.chunk.components.len);
     if (componentType.typeInfo.size > 0) {
-        try entity.chunk.setComponentRaw(self.getListIndexForType(componentType) orelse unreachable, entity.index, componentData);
+        const component_id = self.archetype.world.findComponentId(componentType) orelse unreachable;
+        std.mem.copy(u8, self.getComponentRaw(entity, component_id) orelse unreachable, componentData);
     }
 
     // Copy existing components
-    for (old_entity.chunk.components) |*componentList| {
-        var oldData = componentList.getRaw(old_entity.index);
-        const newComponentIndex = self.getListIndexForType(componentList.componentType) orelse unreachable;
-        try entity.chunk.setComponentRaw(newComponentIndex, entity.index, oldData);
-    }
+    self.copyComponentsFrom(entity, &old_entity);
 }
 
+/// The caller has to remove the entity from its old table afterwards using `removeEntity`.
 pub fn copyEntityIntoRaw(self: *Self, entity: *Entity) !void {
     // @todo: check if the provided components match the archetype
 
     const old_entity = entity.*;
 
     // Add entity
-    var free_chunk = try self.getNextFreeChunk();
-    try free_chunk.addEntity(entity);
+    try self.addRow(entity, old_entity.chunk.table.group);
 
     // Copy existing components
-    for (old_entity.chunk.components) |*component_list| {
-        if (self.getListIndexForType(component_list.componentType)) |index| {
-            var old_data = component_list.getRaw(old_entity.index);
-            try entity.chunk.setComponentRaw(index, entity.index, old_data);
-        }
-    }
+    self.copyComponentsFrom(entity, &old_entity);
 }
 
-pub fn copyEntityWithComponentInto(self: *Self, entity: *Entity, newComponent: anytype) !void {
-    // @todo: check if the provided components match the archetype
-
-    const ComponentType = @TypeOf(newComponent);
+/// Moves all rows into `target` chunk by chunk, copying whole column ranges instead of moving entities one by one.
+/// Both tables have to belong to the same group, so group rows stay where they are.
+/// If `added_component_id` is set that component is set to `added_data` for all moved rows,
+/// every other component of `target` has to exist in this table. Components missing in `target` are dropped.
+pub fn moveAllRowsInto(self: *Self, target: *Self, added_component_id: ?u64, added_data: []const u8) !void {
+    std.debug.assert(self.group == target.group);
+    std.debug.assert(self != target);
 
-    const old_entity = entity.*;
+    const added_column = if (added_component_id) |id| target.getColumnIndex(id) else null;
 
-    // Add entity
-    try self.firstChunk.addEntity(entity);
+    var chunk: ?*Chunk = self.firstChunk;
+    while (chunk) |source| : (chunk = source.next) {
+        var start: u64 = 0;
+        while (start < source.count) {
+            var dest = try target.getNextFreeChunk();
+            const count = std.math.min(source.count - start, dest.capacity - dest.count);
+            const dest_start = dest.count;
+            dest.copyRowsFrom(source, start, count);
+            if (added_column) |column| {
+                dest.fillComponentRaw(column, dest_start, count, added_data);
+            }
+            start += count;
+        }
 
-    // Add new component
-    const componentType = Rtti.typeId(ComponentType);
-    std.debug.assert(self.typeToList.count() == entity.chunk.components.len);
-    if (componentType.size > 0) {
-        try entity.chunk.setComponentRaw(self.getListIndexForType(componentType), entity.index, std.mem.asBytes(&newComponent)) orelse unreachable;
+        if (source.count > 0) {
+            source.removeAllRows();
+        }
     }
 
-    // Copy existing components
-    for (old_entity.chunk.components) |*componentList| {
-        var oldData = componentList.getRaw(old_entity.index);
-        const newComponentIndex = entity.chunk.table.getListIndexForType(componentList.componentType) orelse unreachable;
-        try entity.chunk.setComponentRaw(newComponentIndex, entity.index, oldData);
-    }
+    self.firstFreeChunk = self.firstChunk;
 }
 
 pub fn format(self: *const Self, comptime fmt: []const u8, options: std.fmt.FormatOptions, writer: anytype) !void {
@@ -181,15 +281,3 @@ pub fn format(self: *const Self, comptime fmt: []const u8, options: std.fmt.Form
     _ = options;
     try std.fmt.format(writer, "ArchetypeTable {}", .{self.archetype});
 }
-
-pub const HashTableContext = struct {
-    pub fn hash(context: @This(), self: *Self) u64 {
-        _ = context;
-        return self.archetype.hash;
-    }
-    pub fn eql(context: @This(), a: *Self, b: *Self) bool {
-        _ = context;
-        var ctx = Archetype.Context{};
-        return ctx.eql(&a.archetype, &b.archetype);
-    }
-};
@@ -0,0 +1,87 @@
+//! Maps component sets to archetype tables.
+//! Open addressing with linear probing over a flat array. Each slot stores the cached hash next to the table,
+//! so probing only compares integers and touches the table itself only on a hash match.
+//! Tables are never removed, so there are no tombstones.
+
+const std = @import("std");
+
+const Archetype = @import("archetype.zig");
+const ArchetypeTable = @import("archetype_table.zig");
+
+const BitSet = @import("../util/bit_set.zig");
+
+const Self = @This();
+
+const Slot = struct {
+    hash: u64 = 0,
+    table: ?*ArchetypeTable = null,
+};
+
+const initial_capacity = 64;
+
+allocator: std.mem.Allocator,
+slots: []Slot,
+count: usize = 0,
+
+pub fn init(allocator: std.mem.Allocator) !Self {
+    var slots = try allocator.alloc(Slot, initial_capacity);
+    std.mem.set(Slot, slots, .{});
+    return Self{
+        .allocator = allocator,
+        .slots = slots,
+    };
+}
+
+pub fn deinit(self: *Self) void {
+    self.allocator.free(self.slots);
+}
+
+pub fn get(self: *const Self, components: BitSet, hash: u64) ?*ArchetypeTable {
+    const mask = self.slots.len - 1;
+    var index = hash & mask;
+    while (self.slots[index].table) |table| {
+        if (self.slots[index].hash == hash and std.meta.eql(table.archetype.components, components)) {
+            return table;
+        }
+        index = (index + 1) & mask;
+    }
+    return null;
+}
+
+pub fn getArchetype(self: *const Self, archetype: *const Archetype) ?*ArchetypeTable {
+    return self.get(archetype.components, archetype.hash);
+}
+
+/// Asserts that no table with the same components exists yet.
+pub fn put(self: *Self, table: *ArchetypeTable) !void {
+    std.debug.assert(self.getArchetype(&table.archetype) == null);
+
+    // Keep the load factor at or below 50%, so probe sequences stay short.
+    if ((self.count + 1) * 2 > self.slots.len) {
+        try self.grow();
+    }
+
+    insert(self.slots, table);
+    self.count += 1;
+}
+
+fn insert(slots: []Slot, table: *ArchetypeTable) void {
+    const mask = slots.len - 1;
+    var index = table.archetype.hash & mask;
+    while (slots[index].table != null) {
+        index = (index + 1) & mask;
+    }
+    slots[index] = .{ .hash = table.archetype.hash, .table = table };
+}
+
+fn grow(self: *Self) !void {
+    var slots = try self.allocator.alloc(Slot, self.slots.len * 2);
+    std.mem.set(Slot, slots, .{});
+    for (self.slots) |slot| {
+        if (slot.table) |table| {
+            insert(slots, table);
+        }
+    }
+    self.allocator.free(self.slots);
+    self.slots = slots;
+}
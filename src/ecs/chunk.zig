@@ -9,10 +9,21 @@ const EntityRef = Entity.Ref;
 pub const EntityId = Entity.Id;
 pub const ComponentId = u64;
 
+const root = @import("root");
+
+/// Fills the columns of new chunks with a per column byte pattern, which makes reads of uninitialized components easy to spot.
+/// This touches the whole capacity of every new chunk, so it is opt-in. Define `chunk_debug_fill` in the root file to enable it.
+/// Without it column memory is left uninitialized (the chunk allocator hands out pages which the OS zeroes lazily).
+pub const debug_fill: bool = if (@hasDecl(root, "chunk_debug_fill")) root.chunk_debug_fill else false;
+
 const Self = @This();
 
+/// Columns start on cache line boundaries, so threads writing different columns never share a cache line.
+pub const cache_line_size = 64;
+
 pub const Components = struct {
     componentType: Rtti.TypeId,
+    component_id: u64,
     data: []u8,
 
     pub inline fn getRaw(self: *const @This(), index: u64) []u8 {
@@ -35,7 +46,12 @@ count: u64 = 0,
 
 entity_refs: []EntityRef,
 
-/// Contains data about non zero sized components.
+/// One bit per row, set if the entity in that row is enabled. Bits of rows >= count are undefined.
+/// Queries only look at the mask if `disabled_count` is not zero.
+enabled: []u64,
+disabled_count: u64 = 0,
+
+/// Contains data about non zero sized components, except those owned by the table's group.
 /// To get all components you have to go through table.archetype.components
 components_offset: usize,
 components: []Components,
@@ -47,7 +63,7 @@ pub fn init(table: *ArchetypeTable, capacity: u64, allocator: std.mem.Allocator)
     var size: u64 = @sizeOf(Self);
 
     // [N]Components
-    const numComponents = table.archetype.components.bitSet.count();
+    const numComponents = table.storedComponents().bitSet.count();
     const componentsSize = numComponents * @sizeOf(Components);
     size = std.mem.alignForward(size, @alignOf(Components));
     const componentsIndex = size;
@@ -59,42 +75,55 @@ pub fn init(table: *ArchetypeTable, capacity: u64, allocator: std.mem.Allocator)
     const entityIdsIndex = size;
     size += entityIdsSize;
 
+    // enabled mask
+    const enabledSize = ((capacity + 63) / 64) * @sizeOf(u64);
+    size = std.mem.alignForward(size, @alignOf(u64));
+    const enabledIndex = size;
+    size += enabledSize;
+
     // components
-    size = std.mem.alignForward(size, 64);
+    size = std.mem.alignForward(size, cache_line_size);
     const componentDataIndex = size;
-    var iter = table.archetype.components.iterator();
+    const stored_components = table.storedComponents();
+    var iter = stored_components.iterator();
     while (iter.next()) |componentId| {
         const componentType = table.archetype.world.getComponentType(componentId) orelse unreachable;
         if (componentType.typeInfo.size == 0)
             continue;
 
-        size = std.mem.alignForward(size, componentType.typeInfo.alignment) + capacity * componentType.typeInfo.size + 8;
+        size = std.mem.alignForward(size, columnAlignment(componentType)) + capacity * componentType.typeInfo.size;
     }
 
     const pool = try allocator.alignedAlloc(u8, 4096, size);
 
     //
+    // Entity refs are only read for rows < count, so they don't need to be initialized.
     var entity_refs = std.mem.bytesAsSlice(EntityRef, pool[entityIdsIndex..(entityIdsIndex + entityIdsSize)]);
-    std.mem.set(EntityRef, entity_refs, .{});
+    if (comptime debug_fill) {
+        std.mem.set(EntityRef, entity_refs, .{});
+    }
 
     // Fill components array
     var components = std.mem.bytesAsSlice(Components, pool[componentsIndex..(componentsIndex + componentsSize)]);
     var componentIndex: u64 = 0;
     var currentComponentDataIndex = componentDataIndex;
-    iter = table.archetype.components.iterator();
+    iter = stored_components.iterator();
     while (iter.next()) |componentId| {
         const componentType = table.archetype.world.getComponentType(componentId) orelse unreachable;
         if (componentType.typeInfo.size == 0)
             continue;
         defer componentIndex += 1;
 
-        currentComponentDataIndex = std.mem.alignForward(currentComponentDataIndex, componentType.typeInfo.alignment);
+        currentComponentDataIndex = std.mem.alignForward(currentComponentDataIndex, columnAlignment(componentType));
         components[componentIndex] = Components{
             .componentType = componentType,
+            .component_id = componentId,
             .data = pool[currentComponentDataIndex..(currentComponentDataIndex + capacity * componentType.typeInfo.size)],
         };
-        std.mem.set(u8, components[componentIndex].data, @intCast(u8, componentIndex + 1));
-        currentComponentDataIndex += capacity * componentType.typeInfo.size + 8;
+        if (comptime debug_fill) {
+            std.mem.set(u8, components[componentIndex].data, @intCast(u8, componentIndex + 1));
+        }
+        currentComponentDataIndex += capacity * componentType.typeInfo.size;
     }
     components = components[0..componentIndex];
 
@@ -104,6 +133,7 @@ pub fn init(table: *ArchetypeTable, capacity: u64, allocator: std.mem.Allocator)
         .pool = pool,
         .capacity = capacity,
         .entity_refs = entity_refs,
+        .enabled = std.mem.bytesAsSlice(u64, pool[enabledIndex..(enabledIndex + enabledSize)]),
         .components_offset = componentsIndex,
         .components = components,
         .table = table,
@@ -112,6 +142,38 @@ pub fn init(table: *ArchetypeTable, capacity: u64, allocator: std.mem.Allocator)
     return result;
 }
 
+fn columnAlignment(component_type: Rtti.TypeId) u64 {
+    return std.math.max(cache_line_size, component_type.typeInfo.alignment);
+}
+
+/// Smallest number of rows which covers whole cache lines in every column of this chunk.
+/// Because columns start on cache line boundaries, row ranges starting at multiples of this never share a cache line.
+pub fn getRowsPerCacheLine(self: *const Self) u64 {
+    var rows: u64 = 1;
+    for (self.components) |*component_list| {
+        const size = component_list.componentType.typeInfo.size;
+        // Rows needed to fill a cache line with this column: 64 / gcd(64, size), sizes are never zero here.
+        const shift = std.math.min(@ctz(u64, size), @ctz(u64, cache_line_size));
+        rows = std.math.max(rows, cache_line_size >> @intCast(u6, shift));
+    }
+    return rows;
+}
+
+/// Rounds the number of rows up so a range of that length ends on a cache line boundary in every column.
+pub fn alignRowsToCacheLines(self: *const Self, rows: u64) u64 {
+    return std.mem.alignForwardGeneric(u64, rows, self.getRowsPerCacheLine());
+}
+
+/// Splits the rows of this chunk into `count` ranges on cache line boundaries and returns range `index`.
+/// Threads processing different ranges of the same chunk don't write to shared cache lines.
+pub fn getRowRange(self: *const Self, index: u64, count: u64) struct { start: u64, end: u64 } {
+    std.debug.assert(index < count);
+    const rows_per_range = self.alignRowsToCacheLines((self.count + count - 1) / count);
+    const start = std.math.min(index * rows_per_range, self.count);
+    const end = std.math.min(start + rows_per_range, self.count);
+    return .{ .start = start, .end = end };
+}
+
 pub fn deinit(self: *const Self) ?*Self {
     const next = self.next;
     const pool = self.pool;
@@ -120,6 +182,11 @@ pub fn deinit(self: *const Self) ?*Self {
     return next;
 }
 
+/// Marks a structural change (entity added or removed) in this chunk, which invalidates query iterators over its table.
+pub inline fn bumpVersion(self: *Self) void {
+    self.table.version +%= 1;
+}
+
 pub fn isFull(self: *const Self) bool {
     return self.count >= self.capacity;
 }
@@ -129,6 +196,8 @@ pub fn getOrCreateNext(self: *Self) !*Self {
         return n;
     }
     self.next = try Self.init(self.table, self.capacity * 2, self.allocator);
+    self.table.version +%= 1;
+    self.table.counters.recordChunk(self.next.?);
     return self.next.?;
 }
 
@@ -153,11 +222,16 @@ pub fn addEntity(self: *Self, entity: *Entity) !void {
         chunk = try chunk.getOrCreateNext();
     }
 
-    entity.chunk = chunk;
-    entity.index = chunk.count;
-
-    chunk.entity_refs[entity.index] = .{ .id = entity.id, .entity = entity };
+    chunk.entity_refs[chunk.count] = .{ .id = entity.id, .entity = entity };
+    chunk.setEntityLocation(entity, chunk.count);
+    chunk.writeRowEnabled(chunk.count, !entity.disabled);
+    if (entity.disabled) {
+        chunk.disabled_count += 1;
+        chunk.table.disabled_count += 1;
+    }
     chunk.count += 1;
+    chunk.table.entity_count += 1;
+    chunk.bumpVersion();
 }
 
 pub fn setComponentRaw(self: *Self, componentIndex: u64, dataIndex: u64, data: []const u8) !void {
@@ -170,8 +244,15 @@ pub fn removeEntity(self: *Self, index: u64) void {
     std.debug.assert(index < self.count);
 
     self.table.updateFirstFreeChunk(self);
+    self.bumpVersion();
+
+    if (!self.isRowEnabled(index)) {
+        self.disabled_count -= 1;
+        self.table.disabled_count -= 1;
+    }
 
     self.count -= 1;
+    self.table.entity_count -= 1;
     if (index < self.count) {
         self.entity_refs[index] = self.entity_refs[self.count];
         self.entity_refs[self.count] = .{ .id = 0, .entity = undefined };
@@ -182,6 +263,126 @@ pub fn removeEntity(self: *Self, index: u64) void {
             std.mem.copy(u8, target, source);
         }
 
-        self.entity_refs[index].entity.index = index;
+        self.writeRowEnabled(index, self.isRowEnabled(self.count));
+        self.setEntityLocation(self.entity_refs[index].entity, index);
+    }
+}
+
+/// Appends `count` rows of `source` starting at `start`, copying whole column ranges instead of single rows.
+/// Columns `source` doesn't have are left uninitialized, columns this chunk doesn't have are dropped.
+/// The rows have to be removed from `source` afterwards, e.g. with `removeAllRows`.
+pub fn copyRowsFrom(self: *Self, source: *const Self, start: u64, count: u64) void {
+    std.debug.assert(self.count + count <= self.capacity);
+    std.debug.assert(start + count <= source.count);
+
+    const dest_start = self.count;
+    std.mem.copy(EntityRef, self.entity_refs[dest_start..(dest_start + count)], source.entity_refs[start..(start + count)]);
+
+    for (self.components) |*component_list| {
+        if (source.table.getColumnIndex(component_list.component_id)) |source_column| {
+            const size = component_list.componentType.typeInfo.size;
+            const source_data = source.components[source_column].data[(start * size)..((start + count) * size)];
+            std.mem.copy(u8, component_list.data[(dest_start * size)..((dest_start + count) * size)], source_data);
+        }
+    }
+
+    var i: u64 = 0;
+    while (i < count) : (i += 1) {
+        const enabled = source.isRowEnabled(start + i);
+        self.writeRowEnabled(dest_start + i, enabled);
+        if (!enabled) {
+            self.disabled_count += 1;
+            self.table.disabled_count += 1;
+        }
+        self.setEntityLocation(self.entity_refs[dest_start + i].entity, dest_start + i);
+    }
+
+    self.count += count;
+    self.table.entity_count += count;
+    self.bumpVersion();
+}
+
+/// Sets `count` rows of a column starting at `start` to the same value.
+/// Copies already written rows in doubling steps, so this is bound by memcpy, not the row count.
+pub fn fillComponentRaw(self: *Self, componentIndex: u64, start: u64, count: u64, data: []const u8) void {
+    if (count == 0) {
+        return;
+    }
+
+    const size = data.len;
+    var column = self.getComponents(componentIndex).data[(start * size)..((start + count) * size)];
+    std.mem.copy(u8, column[0..size], data);
+    var filled: u64 = size;
+    while (filled < column.len) {
+        const n = std.math.min(filled, column.len - filled);
+        std.mem.copy(u8, column[filled..(filled + n)], column[0..n]);
+        filled += n;
+    }
+}
+
+/// Drops all rows at once. Only valid if the entities were moved somewhere else, see `copyRowsFrom`.
+pub fn removeAllRows(self: *Self) void {
+    self.table.entity_count -= self.count;
+    self.table.disabled_count -= self.disabled_count;
+    self.count = 0;
+    self.disabled_count = 0;
+    self.bumpVersion();
+}
+
+pub inline fn isRowEnabled(self: *const Self, index: u64) bool {
+    return self.enabled[index / 64] & rowBit(index) != 0;
+}
+
+/// Doesn't change the version, enabling or disabling rows is not a structural change.
+pub fn setRowEnabled(self: *Self, index: u64, enabled: bool) void {
+    std.debug.assert(index < self.count);
+    if (self.isRowEnabled(index) == enabled) {
+        return;
+    }
+
+    self.writeRowEnabled(index, enabled);
+    if (enabled) {
+        self.disabled_count -= 1;
+        self.table.disabled_count -= 1;
+    } else {
+        self.disabled_count += 1;
+        self.table.disabled_count += 1;
+    }
+}
+
+/// Returns the first enabled row at or after `index`, or `count` if there is none.
+/// Scans the mask one word at a time, so runs of disabled rows are skipped 64 rows at once.
+pub fn nextEnabledRow(self: *const Self, index: u64) u64 {
+    var row = index;
+    while (row < self.count) {
+        const bits = self.enabled[row / 64] >> @intCast(u6, row % 64);
+        if (bits != 0) {
+            return std.math.min(row + @ctz(u64, bits), self.count);
+        }
+        row = (row / 64 + 1) * 64;
+    }
+    return self.count;
+}
+
+inline fn rowBit(index: u64) u64 {
+    return @as(u64, 1) << @intCast(u6, index % 64);
+}
+
+inline fn writeRowEnabled(self: *Self, index: u64, enabled: bool) void {
+    if (enabled) {
+        self.enabled[index / 64] |= rowBit(index);
+    } else {
+        self.enabled[index / 64] &= ~rowBit(index);
+    }
+}
+
+/// Rows in the storage of a group are tracked separately from the row in the entity's archetype table.
+inline fn setEntityLocation(self: *Self, entity: *Entity, index: u64) void {
+    if (self.table.is_group_storage) {
+        entity.group_chunk = self;
+        entity.group_index = index;
+    } else {
+        entity.chunk = self;
+        entity.index = index;
     }
 }
@@ -54,12 +54,20 @@ const Commands = union(enum) {
         entity_ref: EntityRef,
         component_type: Rtti.TypeId,
     },
+    SetEntityEnabled: struct {
+        entity_ref: EntityRef,
+        enabled: bool,
+    },
 };
 
 commands: std.ArrayList(Commands),
 component_data_arena: ArenaAllocator,
 world: *World,
 
+/// If set, `applyCommands` folds every applied command into `stream_hash`, so two runs can be compared cheaply.
+hash_stream: bool = false,
+stream_hash: u64 = 0,
+
 pub fn init(allocator: std.mem.Allocator, world: *World) Self {
     return Self{
         .commands = std.ArrayList(Commands).init(allocator),
@@ -124,6 +132,14 @@ pub fn destroyEntity(self: *Self, entity_ref: EntityRef) !void {
     try self.commands.append(.{ .DestroyEntity = entity_ref });
 }
 
+pub fn enableEntity(self: *Self, entity_ref: EntityRef) !void {
+    try self.commands.append(.{ .SetEntityEnabled = .{ .entity_ref = entity_ref, .enabled = true } });
+}
+
+pub fn disableEntity(self: *Self, entity_ref: EntityRef) !void {
+    try self.commands.append(.{ .SetEntityEnabled = .{ .entity_ref = entity_ref, .enabled = false } });
+}
+
 pub fn addComponent(self: *Self, entity: TempEntityId, component: anytype) !TempEntityId {
     return self.addComponentRaw(entity, Rtti.typeId(@TypeOf(component)), std.mem.asBytes(&component));
 }
@@ -160,6 +176,16 @@ pub fn applyCommands(self: *Self) !void {
         self.component_data_arena.reset();
     }
 
+    self.world.counters.recordCommands(self.commands.items.len);
+
+    if (self.hash_stream) {
+        var hasher = std.hash.Wyhash.init(self.stream_hash);
+        for (self.commands.items) |command| {
+            hashCommand(&hasher, command);
+        }
+        self.stream_hash = hasher.final();
+    }
+
     for (self.commands.items) |command| {
         switch (command) {
             .CreateEntity => |entity_ref| {
@@ -181,10 +207,47 @@ pub fn applyCommands(self: *Self) !void {
             .RemoveComponent => |data| {
                 try self.world.removeComponent(data.entity_ref, data.component_type);
             },
+
+            .SetEntityEnabled => |data| {
+                try self.world.setEntityEnabled(data.entity_ref, data.enabled);
+            },
         }
     }
 }
 
+/// Only hashes what is the same in every run: the kind of command, entity ids and component type names.
+/// Component data is skipped because it can contain pointers, e.g. to assets.
+fn hashCommand(hasher: *std.hash.Wyhash, command: Commands) void {
+    std.hash.autoHash(hasher, std.meta.activeTag(command));
+    switch (command) {
+        .CreateEntity, .DestroyEntity => |entity_ref| {
+            std.hash.autoHash(hasher, entity_ref.id);
+        },
+
+        .CreateEntityBundle => |data| {
+            std.hash.autoHash(hasher, data.entity_ref.id);
+            for (data.component_types) |component_type| {
+                hasher.update(component_type.typeInfo.name);
+            }
+        },
+
+        .AddComponent => |data| {
+            std.hash.autoHash(hasher, data.entity_ref.id);
+            hasher.update(data.component_type.typeInfo.name);
+        },
+
+        .RemoveComponent => |data| {
+            std.hash.autoHash(hasher, data.entity_ref.id);
+            hasher.update(data.component_type.typeInfo.name);
+        },
+
+        .SetEntityEnabled => |data| {
+            std.hash.autoHash(hasher, data.entity_ref.id);
+            std.hash.autoHash(hasher, data.enabled);
+        },
+    }
+}
+
 pub fn imguiDetails(self: *Self) void {
     _ = self;
 }
@@ -39,15 +39,14 @@ fn printConnection(self: *Self, writer: anytype, from: *const ArchetypeTable, to
 }
 
 pub fn printGraph(self: *Self, writer: anytype, world: *const World) anyerror!void {
-    var tableIter = world.archetypeTables.valueIterator();
-    while (tableIter.next()) |table| {
+    for (world.archetypeTablesArray.items) |table| {
         try self.newLine(writer);
-        try self.printTable(writer, table.*);
+        try self.printTable(writer, table);
 
-        var subsetIter = table.*.subsets.iterator();
+        var subsetIter = table.subsets.iterator();
         while (subsetIter.next()) |entry| {
             try self.newLine(writer);
-            try self.printConnection(writer, table.*, entry.value_ptr.*, "red", Archetype.init(@intToPtr(*World, @ptrToInt(world)), 0, entry.key_ptr.*));
+            try self.printConnection(writer, table, entry.value_ptr.*, "red", Archetype.init(@intToPtr(*World, @ptrToInt(world)), entry.key_ptr.*));
         }
 
         // var supersetIter = table.*.supersets.valueIterator();
@@ -27,6 +27,15 @@ id: u64 = 0,
 chunk: *Chunk = undefined,
 index: u64 = 0,
 
+/// Row in the storage of the group which owns some of this entity's components.
+/// Only valid if `chunk.table.group` is set.
+group_chunk: *Chunk = undefined,
+group_index: u64 = 0,
+
+/// Disabled entities are skipped by queries, see `World.setEntityEnabled`.
+/// Kept here so the state survives moves between tables, chunks mirror it in their enabled masks.
+disabled: bool = false,
+
 pub fn format(self: *const @This(), comptime fmt: []const u8, options: std.fmt.FormatOptions, writer: anytype) !void {
     _ = fmt;
     _ = options;
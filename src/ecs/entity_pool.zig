@@ -0,0 +1,67 @@
+//! Keeps entities which are not needed anymore as disabled entities, so they can be reused
+//! without creating entities or moving rows between archetype tables.
+//! All entities in one pool are expected to have the same components, e.g. one kind of projectile.
+
+const std = @import("std");
+
+const Commands = @import("commands.zig");
+const Entity = @import("entity.zig");
+const EntityRef = Entity.Ref;
+const World = @import("world.zig");
+
+const Self = @This();
+
+parked: std.ArrayList(EntityRef),
+
+pub fn init(allocator: std.mem.Allocator) Self {
+    return Self{
+        .parked = std.ArrayList(EntityRef).init(allocator),
+    };
+}
+
+pub fn deinit(self: *const Self) void {
+    self.parked.deinit();
+}
+
+/// Disables the entity when the commands are applied and keeps it for `spawn`.
+pub fn park(self: *Self, commands: *Commands, entity_ref: EntityRef) !void {
+    try commands.disableEntity(entity_ref);
+    try self.parked.append(entity_ref);
+}
+
+/// Overwrites the components of a parked entity and enables it again when the commands are applied.
+/// Only entities whose disable was already applied are reused, the others may still be in use this frame.
+/// Creates a new entity if no such entity is left.
+pub fn spawn(self: *Self, world: *World, commands: *Commands, components: anytype) !EntityRef {
+    const ComponentsType = if (@typeInfo(@TypeOf(components)) == .Pointer) std.meta.Child(@TypeOf(components)) else @TypeOf(components);
+    const components_ptr: *const ComponentsType = if (@typeInfo(@TypeOf(components)) == .Pointer) components else &components;
+
+    // The oldest entities come first, so they are the most likely to be disabled already.
+    var i: usize = 0;
+    while (i < self.parked.items.len) {
+        const entity_ref = self.parked.items[i];
+
+        // Entities can be destroyed by someone else while they are parked.
+        const entity = entity_ref.get() orelse {
+            _ = self.parked.orderedRemove(i);
+            continue;
+        };
+        if (!entity.disabled) {
+            i += 1;
+            continue;
+        }
+        _ = self.parked.orderedRemove(i);
+
+        inline for (@typeInfo(ComponentsType).Struct.fields) |field| {
+            if (@sizeOf(field.field_type) > 0) {
+                const component = (try world.getComponent(entity_ref, field.field_type)) orelse return error.ParkedEntityIsMissingComponent;
+                component.* = @field(components_ptr.*, field.name);
+            }
+        }
+
+        try commands.enableEntity(entity_ref);
+        return entity_ref;
+    }
+
+    return (try commands.createEntityBundle(components_ptr)).build();
+}
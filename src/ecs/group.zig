@@ -0,0 +1,48 @@
+//! An owning group stores the owned components of every entity which has all of them
+//! in one densely packed table, no matter which archetype table the entity is in.
+//! Archetype tables containing all owned components point to the group (`table.group`)
+//! and don't have columns for these components.
+//! Groups are created with `World.addGroup`.
+
+const std = @import("std");
+
+const Archetype = @import("archetype.zig");
+const ArchetypeTable = @import("archetype_table.zig");
+const Entity = @import("entity.zig");
+
+const BitSet = @import("../util/bit_set.zig");
+
+components: BitSet,
+storage: ArchetypeTable,
+
+const Self = @This();
+
+pub fn init(self: *Self, archetype: Archetype, allocator: std.mem.Allocator, chunk_allocator: std.mem.Allocator) !void {
+    self.components = archetype.components;
+    try self.storage.init(archetype, null, allocator, chunk_allocator);
+    self.storage.is_group_storage = true;
+}
+
+pub fn deinit(self: *Self) void {
+    self.storage.deinit();
+}
+
+/// Adds a row for the entity, the owned components have to be written by the caller.
+pub fn addEntity(self: *Self, entity: *Entity) !void {
+    var free_chunk = try self.storage.getNextFreeChunk();
+    try free_chunk.addEntity(entity);
+}
+
+pub fn removeEntity(self: *Self, entity: *const Entity) void {
+    _ = self;
+    entity.group_chunk.removeEntity(entity.group_index);
+}
+
+pub fn getComponentRaw(self: *const Self, entity: *const Entity, component_id: u64) ?[]u8 {
+    const index = self.storage.getColumnIndex(component_id) orelse return null;
+    return entity.group_chunk.getComponentRaw(index, entity.group_index);
+}
+
+pub fn getEntityCount(self: *const Self) usize {
+    return self.storage.getEntityCount();
+}
@@ -0,0 +1,47 @@
+//! Resource for updating entities at a reduced frequency depending on their level of detail.
+//! Entities in bucket k are only updated every 2^k frames, with the delta time of all frames since their last update.
+//! Each entity is offset by its id, so the entities of one bucket are spread evenly over the frames.
+//! The bucket of an entity is stored in a `LodComponent` and has to be computed by the game, e.g. from the distance to the camera.
+
+const std = @import("std");
+
+const Self = @This();
+
+pub const bucket_count = 4;
+
+pub const LodComponent = struct {
+    /// 0 updates every frame, `bucket_count - 1` every 2^(bucket_count - 1) frames.
+    bucket: u8 = 0,
+};
+
+frame: u64 = 0,
+/// Delta times of the last `1 << (bucket_count - 1)` frames, indexed by frame.
+deltas: [1 << (bucket_count - 1)]f32 = [_]f32{0} ** (1 << (bucket_count - 1)),
+/// Sum of the last 2^k delta times for bucket k.
+bucket_deltas: [bucket_count]f32 = [_]f32{0} ** bucket_count,
+
+/// Has to be called once per frame before any system uses `getDelta`.
+pub fn update(self: *Self, delta: f32) void {
+    self.frame += 1;
+    self.deltas[self.frame % self.deltas.len] = delta;
+
+    for (self.bucket_deltas) |*bucket_delta, k| {
+        const frames = @as(u64, 1) << @intCast(u6, k);
+        bucket_delta.* = 0;
+        var i: u64 = 0;
+        while (i < frames) : (i += 1) {
+            bucket_delta.* += self.deltas[(self.frame -% i) % self.deltas.len];
+        }
+    }
+}
+
+/// Returns the delta time since the last update of an entity in `bucket`, or null if it is not updated this frame.
+/// Entities changing buckets can gain or lose the time of a few frames, which is not noticeable for entities with a low level of detail.
+pub fn getDelta(self: *const Self, bucket: u8, entity_id: u64) ?f32 {
+    const k = std.math.min(bucket, bucket_count - 1);
+    const mask = (@as(u64, 1) << @intCast(u6, k)) - 1;
+    if (((self.frame +% entity_id) & mask) != 0) {
+        return null;
+    }
+    return self.bucket_deltas[k];
+}
@@ -0,0 +1,144 @@
+const std = @import("std");
+
+const Entity = @import("entity.zig");
+const EntityRef = Entity.Ref;
+const SystemParameterType = @import("system_parameter_type.zig").SystemParameterType;
+
+const BitSet = @import("../util/bit_set.zig");
+
+pub const ObserverKind = enum {
+    Added,
+    Removed,
+};
+
+/// System parameter containing all entities which got a `Component` added since the system last ran.
+pub fn Added(comptime Component: type) type {
+    return Observer(.Added, Component);
+}
+
+/// System parameter containing all entities which got a `Component` removed (or were destroyed) since the system last ran.
+pub fn Removed(comptime Component: type) type {
+    return Observer(.Removed, Component);
+}
+
+fn Observer(comptime kind: ObserverKind, comptime Component: type) type {
+    return struct {
+        pub const Type = SystemParameterType.Observer;
+        pub const Kind = kind;
+        pub const ComponentType = Component;
+
+        /// In the order the events happened. Refs of entities which were destroyed since are not valid anymore,
+        /// but still contain the id of the entity.
+        entities: []const EntityRef,
+    };
+}
+
+/// Events for one component. They are recorded into `recording` and moved to `delivered` at the end of the frame.
+/// Delivered events stay until every observer consumed them, so an observer whose system is skipped in a frame
+/// gets them in the next run instead of losing them.
+const Events = struct {
+    recording: std.ArrayListUnmanaged(EntityRef) = .{},
+    delivered: std.ArrayListUnmanaged(EntityRef) = .{},
+    /// Sequence number of the first delivered event.
+    first: u64 = 0,
+    /// Sequence number of the next event each observer hasn't consumed yet, indexed by observer id.
+    cursors: std.ArrayListUnmanaged(u64) = .{},
+
+    fn deinit(self: *@This(), allocator: std.mem.Allocator) void {
+        self.recording.deinit(allocator);
+        self.delivered.deinit(allocator);
+        self.cursors.deinit(allocator);
+    }
+
+    fn getPending(self: *const @This(), observer: usize) []const EntityRef {
+        return self.delivered.items[self.cursors.items[observer] - self.first ..];
+    }
+
+    fn consume(self: *@This(), observer: usize) void {
+        self.cursors.items[observer] = self.first + self.delivered.items.len;
+    }
+
+    fn endFrame(self: *@This(), allocator: std.mem.Allocator) !void {
+        var consumed = self.delivered.items.len;
+        for (self.cursors.items) |cursor| {
+            consumed = std.math.min(consumed, cursor - self.first);
+        }
+        self.first += consumed;
+
+        if (consumed == self.delivered.items.len) {
+            // Common case, every observer ran.
+            std.mem.swap(std.ArrayListUnmanaged(EntityRef), &self.recording, &self.delivered);
+        } else {
+            const remaining = self.delivered.items[consumed..];
+            std.mem.copy(EntityRef, self.delivered.items[0..remaining.len], remaining);
+            self.delivered.shrinkRetainingCapacity(remaining.len);
+            // On failure the events stay in `recording` and are delivered at the end of the next frame.
+            try self.delivered.appendSlice(allocator, self.recording.items);
+        }
+        self.recording.clearRetainingCapacity();
+    }
+};
+
+/// Events of one kind for all observed components, indexed by component id.
+/// Structural changes only pay for a bit set intersection unless one of the involved components is observed.
+pub const ObserverSet = struct {
+    allocator: std.mem.Allocator,
+    observed: BitSet = BitSet.initEmpty(),
+    events: [BitSet.capacity]Events = [_]Events{.{}} ** BitSet.capacity,
+
+    pub fn init(allocator: std.mem.Allocator) @This() {
+        return .{ .allocator = allocator };
+    }
+
+    pub fn deinit(self: *@This()) void {
+        for (self.events) |*events| {
+            events.deinit(self.allocator);
+        }
+    }
+
+    /// Returns the id of the new observer, which is used to get and consume its events.
+    /// Its first events are the ones delivered at the end of the current frame.
+    pub fn observe(self: *@This(), component_id: u64) !usize {
+        const events = &self.events[component_id];
+        try events.cursors.append(self.allocator, events.first + events.delivered.items.len);
+        self.observed.set(component_id);
+        return events.cursors.items.len - 1;
+    }
+
+    /// Records an event for each observed component in `components`.
+    pub fn record(self: *@This(), components: BitSet, entity_ref: EntityRef) !void {
+        var observed = components;
+        observed.setIntersection(self.observed);
+        var iter = observed.iterator();
+        while (iter.next()) |component_id| {
+            try self.events[component_id].recording.append(self.allocator, entity_ref);
+        }
+    }
+
+    /// Records an event for each observed component in `components` for all entities.
+    pub fn recordAll(self: *@This(), components: BitSet, entity_refs: []const EntityRef) !void {
+        var observed = components;
+        observed.setIntersection(self.observed);
+        var iter = observed.iterator();
+        while (iter.next()) |component_id| {
+            try self.events[component_id].recording.appendSlice(self.allocator, entity_refs);
+        }
+    }
+
+    /// Delivered events the observer didn't consume yet.
+    pub fn getPending(self: *const @This(), component_id: u64, observer: usize) []const EntityRef {
+        return self.events[component_id].getPending(observer);
+    }
+
+    /// Marks all events returned by `getPending` as seen by the observer.
+    pub fn consume(self: *@This(), component_id: u64, observer: usize) void {
+        self.events[component_id].consume(observer);
+    }
+
+    pub fn endFrame(self: *@This()) !void {
+        var iter = self.observed.iterator();
+        while (iter.next()) |component_id| {
+            try self.events[component_id].endFrame(self.allocator);
+        }
+    }
+};
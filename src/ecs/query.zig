@@ -15,36 +15,84 @@ pub const ComponentId = u64;
 
 const root = @import("root");
 
-pub const track_iter_invalidation: bool = if (@hasDecl(root, "query_track_iter_invalidation")) root.query_track_iter_invalidation else false;
+/// Checking for invalidation only compares the version of the table an iterator is currently in on every `next`,
+/// and the versions of all covered tables once at the end, so it is cheap enough to stay enabled in release builds.
+/// Define `query_track_iter_invalidation` in the root file to override.
+pub const track_iter_invalidation: bool = if (@hasDecl(root, "query_track_iter_invalidation")) root.query_track_iter_invalidation else true;
+
+/// Version used by iterators which are not inside a chunk (e.g. empty queries).
+const no_table_version: u64 = 0;
 
 pub fn Query(comptime Components: anytype) type {
     const EntityHandle = getEntityHandle(Components);
     const ComponentSlices = getEntityHandles(Components);
+    const component_count = @typeInfo(@TypeOf(Components)).Struct.fields.len;
 
     const Iterator = struct {
         const Self = @This();
 
         allocator: std.mem.Allocator,
+        /// Whether the iterator owns `tables` and `chunks`.
         free_chunks: bool,
 
         world: *World,
-        version: u128,
+
+        /// Table of the current chunk, its version and the value it had when the iterator entered its first chunk.
+        /// The table version also changes for chunks which were already visited or added later.
+        table: ?*const ArchetypeTable = null,
+        table_version: *const u64 = &no_table_version,
+        version: u64 = no_table_version,
+
+        /// Same for the group storage of the current chunk's table, if the query reads components owned by the group.
+        group_storage: ?*const ArchetypeTable = null,
+        group_storage_version: *const u64 = &no_table_version,
+        group_version: u64 = no_table_version,
+
+        /// Tables covered by the query and the sum of their versions when the iterator was created.
+        /// Versions only increase, so the sum changes if any of them changed. Checked at the end of the iteration,
+        /// which catches changes to tables made before the iterator reached them. Changes to other tables don't invalidate the iterator.
+        tables: []const *ArchetypeTable,
+        tables_version: u64 = 0,
 
         chunks: []*Chunk,
         chunk_index: usize = 0,
         entity_index: u64 = 0,
 
+        /// Set if the current chunk has disabled rows, which have to be skipped using its enabled mask.
+        /// Fully enabled chunks are iterated densely.
+        sparse: bool = false,
+
         entity_handles: ComponentSlices = std.mem.zeroes(ComponentSlices),
         current_entity: EntityHandle = undefined,
 
-        pub fn init(allocator: std.mem.Allocator, chunks: []*Chunk, free_chunks: bool, world: *World) @This() {
+        /// Ids of the components in `world`, resolved once so entering a chunk only indexes `table.columns`.
+        component_ids: [component_count]u64 = undefined,
+
+        /// Bit i is set if component i is owned by the group of the current chunk's table.
+        /// These components are not in the chunk and are looked up per entity in `group_columns[i]` of the group storage.
+        group_owned: u64 = 0,
+        group_columns: [component_count]u64 = undefined,
+
+        pub fn init(allocator: std.mem.Allocator, tables: []const *ArchetypeTable, chunks: []*Chunk, free_chunks: bool, world: *World) @This() {
             var result = @This(){
                 .allocator = allocator,
                 .free_chunks = free_chunks,
                 .chunks = chunks,
                 .world = world,
-                .version = world.version,
+                .tables = tables,
             };
+            if (comptime track_iter_invalidation) {
+                result.tables_version = sumTableVersions(tables);
+            }
+
+            const typeInfo = @typeInfo(@TypeOf(Components)).Struct;
+            inline for (typeInfo.fields) |field, i| {
+                const ComponentType = @field(Components, field.name);
+                if (@sizeOf(ComponentType) > 0) {
+                    // Only queries on existing archetypes create iterators, so all components have ids.
+                    result.component_ids[i] = world.findComponentId(Rtti.typeId(ComponentType)) orelse unreachable;
+                }
+            }
 
             if (result.chunks.len > 0) {
                 result.updateForCurrentChunk();
@@ -55,47 +103,132 @@ pub fn Query(comptime Components: anytype) type {
 
         pub fn deinit(self: *const Self) void {
             if (self.free_chunks) {
+                self.allocator.free(self.tables);
                 self.allocator.free(self.chunks);
             }
         }
 
+        /// Continues at `row` of chunk `chunk_index`. Positions past the last chunk are ignored.
+        pub fn seek(self: *Self, chunk_index: usize, row: u64) void {
+            if (chunk_index >= self.chunks.len)
+                return;
+
+            self.chunk_index = chunk_index;
+            self.entity_index = row;
+            self.updateForCurrentChunk();
+        }
+
+        fn sumTableVersions(tables: []const *ArchetypeTable) u64 {
+            var sum: u64 = 0;
+            for (tables) |table| {
+                sum +%= table.version;
+            }
+            return sum;
+        }
+
+        fn checkTables(self: *const Self) void {
+            const tables_version = sumTableVersions(self.tables);
+            if (tables_version != self.tables_version) {
+                std.log.err("Query Iterator was invalidated. (Created at table versions {}, now {})", .{ self.tables_version, tables_version });
+                @panic("Query Iterator was invalidated");
+            }
+        }
+
         pub fn updateForCurrentChunk(self: *Self) void {
             const chunk = self.chunks[self.chunk_index];
             const typeInfo = @typeInfo(@TypeOf(Components)).Struct;
             const resultTypeInfo = @typeInfo(EntityHandle).Struct;
 
+            if (comptime track_iter_invalidation) {
+                self.enterTable(chunk.table);
+            }
+            self.sparse = chunk.disabled_count > 0;
+
             self.entity_handles.ref = chunk.entity_refs[0..chunk.count];
+            self.group_owned = 0;
 
             inline for (typeInfo.fields) |field, i| {
                 const ComponentType = @field(Components, field.name);
                 std.debug.assert(@TypeOf(ComponentType) == type);
                 if (@sizeOf(ComponentType) > 0) {
-                    const component_index = chunk.table.getListIndexForType(Rtti.typeId(ComponentType)) orelse unreachable;
-                    const components = std.mem.bytesAsSlice(ComponentType, @alignCast(@alignOf(ComponentType), chunk.getComponents(component_index).data));
-                    @field(self.entity_handles, resultTypeInfo.fields[i + 1].name) = components[0..chunk.count];
+                    const component_id = self.component_ids[i];
+                    if (chunk.table.getColumnIndex(component_id)) |component_index| {
+                        const components = std.mem.bytesAsSlice(ComponentType, @alignCast(@alignOf(ComponentType), chunk.getComponents(component_index).data));
+                        @field(self.entity_handles, resultTypeInfo.fields[i + 1].name) = components[0..chunk.count];
+                    } else {
+                        const group = chunk.table.group orelse unreachable;
+                        self.group_columns[i] = group.storage.getColumnIndex(component_id) orelse unreachable;
+                        self.group_owned |= @as(u64, 1) << i;
+                    }
                 }
             }
+
+            if (comptime track_iter_invalidation) {
+                if (self.group_owned != 0) {
+                    self.enterGroupStorage(&chunk.table.group.?.storage);
+                } else {
+                    self.group_storage_version = &no_table_version;
+                    self.group_version = no_table_version;
+                }
+            }
+        }
+
+        /// Only the first chunk of a table records its version, later chunks of the same table compare against it.
+        fn enterTable(self: *Self, table: *const ArchetypeTable) void {
+            if (self.table == table) {
+                if (table.version != self.version) {
+                    std.log.err("Query Iterator was invalidated. (Entered table at {}, table at {})", .{ self.version, table.version });
+                    @panic("Query Iterator was invalidated");
+                }
+                return;
+            }
+            self.table = table;
+            self.table_version = &table.version;
+            self.version = table.version;
+        }
+
+        fn enterGroupStorage(self: *Self, storage: *const ArchetypeTable) void {
+            if (self.group_storage == storage) {
+                if (storage.version != self.group_version) {
+                    std.log.err("Query Iterator was invalidated. (Entered group storage at {}, storage at {})", .{ self.group_version, storage.version });
+                    @panic("Query Iterator was invalidated");
+                }
+            } else {
+                self.group_storage = storage;
+                self.group_version = storage.version;
+            }
+            self.group_storage_version = &storage.version;
         }
 
         pub fn count(self: *const Self) usize {
             var result: usize = 0;
             for (self.chunks) |chunk| {
-                result += chunk.count;
+                result += chunk.count - chunk.disabled_count;
             }
             return result;
         }
 
         pub inline fn next(self: *Self) ?*EntityHandle {
             if (comptime track_iter_invalidation) {
-                if (self.world.version != self.version) {
-                    std.log.err("Query Iterator was invalidated. (Created at {}, world at {})", .{ self.version, self.world.version });
+                if (self.table_version.* != self.version or self.group_storage_version.* != self.group_version) {
+                    std.log.err("Query Iterator was invalidated. (Entered table at {}, table at {})", .{ self.version, self.table_version.* });
                     @panic("Query Iterator was invalidated");
                 }
             }
 
-            if (self.entity_index >= self.entity_handles.ref.len) {
-                if (self.chunk_index + 1 >= self.chunks.len)
+            while (true) {
+                if (self.sparse) {
+                    self.entity_index = self.chunks[self.chunk_index].nextEnabledRow(self.entity_index);
+                }
+                if (self.entity_index < self.entity_handles.ref.len)
+                    break;
+
+                if (self.chunk_index + 1 >= self.chunks.len) {
+                    if (comptime track_iter_invalidation) {
+                        self.checkTables();
+                    }
                     return null;
+                }
 
                 self.entity_index = 0;
                 self.chunk_index += 1;
@@ -110,7 +243,13 @@ pub fn Query(comptime Components: anytype) type {
                 const field_name = resultTypeInfo.fields[i + 1].name;
                 const ComponentType = @field(Components, field.name);
                 if (@sizeOf(ComponentType) > 0) {
-                    @field(self.current_entity, field_name) = &@field(self.entity_handles, field_name)[self.entity_index];
+                    if (self.group_owned & (@as(u64, 1) << i) != 0) {
+                        const entity = self.entity_handles.ref[self.entity_index].entity;
+                        const data = entity.group_chunk.getComponents(self.group_columns[i]).getRaw(entity.group_index);
+                        @field(self.current_entity, field_name) = @ptrCast(*ComponentType, @alignCast(@alignOf(ComponentType), data.ptr));
+                    } else {
+                        @field(self.current_entity, field_name) = &@field(self.entity_handles, field_name)[self.entity_index];
+                    }
                 }
             }
 
@@ -130,14 +269,18 @@ pub fn Query(comptime Components: anytype) type {
 
         allocator: std.mem.Allocator,
         world: *World,
+        /// All matching tables, used for counting without walking chunks.
+        tables: []*ArchetypeTable,
         chunks: []*Chunk,
+        /// Whether the query owns `tables` and `chunks`.
         free_chunks: bool,
         componentCount: i64 = ComponentCount,
 
-        pub fn init(allocator: std.mem.Allocator, world: *World, chunks: []*Chunk, free_chunks: bool) @This() {
+        pub fn init(allocator: std.mem.Allocator, world: *World, tables: []*ArchetypeTable, chunks: []*Chunk, free_chunks: bool) @This() {
             return @This(){
                 .allocator = allocator,
                 .world = world,
+                .tables = tables,
                 .chunks = chunks,
                 .free_chunks = free_chunks,
             };
@@ -145,23 +288,24 @@ pub fn Query(comptime Components: anytype) type {
 
         pub fn deinit(self: *const Self) void {
             if (self.free_chunks) {
+                self.allocator.free(self.tables);
                 self.allocator.free(self.chunks);
             }
         }
 
         pub fn iter(self: *const Self) Iterator {
-            return Iterator.init(self.allocator, self.chunks, false, self.world);
+            return Iterator.init(self.allocator, self.tables, self.chunks, false, self.world);
         }
 
         pub fn iterOwned(self: *const Self) Iterator {
-            return Iterator.init(self.allocator, self.chunks, true, self.world);
+            return Iterator.init(self.allocator, self.tables, self.chunks, true, self.world);
         }
 
-        // Returns the number of entities which match this query.
+        // Returns the number of enabled entities which match this query.
         pub fn count(self: *const Self) u64 {
             var result: u64 = 0;
-            for (self.chunks) |chunk| {
-                result += chunk.count;
+            for (self.tables) |table| {
+                result += table.getEnabledEntityCount();
             }
             return result;
         }
@@ -170,6 +314,124 @@ pub fn Query(comptime Components: anytype) type {
     return QueryTemplate;
 }
 
+/// Limits how much of its query a `Sliced` parameter processes per run. Zero means no limit.
+pub const SliceBudget = struct {
+    entities: u64 = 0,
+    /// Checked every `time_check_interval` entities, so slices can overshoot by that many entities.
+    time_ns: u64 = 0,
+};
+
+/// Position where a `Sliced` parameter continues in the next run, kept in the system's state.
+/// Chunks are never freed while the world exists, so the pointer can be compared even if the chunk list changed.
+pub const SliceCursor = struct {
+    chunk: ?*Chunk = null,
+    row: u64 = 0,
+    /// Number of times the whole query was processed.
+    passes: u64 = 0,
+};
+
+const time_check_interval = 32;
+
+/// System parameter like `Query`, but iterating only a slice of the matching entities per run within `budget`.
+/// The next run continues where the last one stopped, once the end is reached the next run starts from the beginning.
+/// For work which doesn't need every entity every frame, e.g. despawning entities far away.
+pub fn Sliced(comptime Components: anytype, comptime budget: SliceBudget) type {
+    const QueryType = Query(Components);
+
+    const SlicedIterator = struct {
+        const Self = @This();
+
+        inner: QueryType.Iterator,
+        cursor: *SliceCursor,
+        processed: u64 = 0,
+        start_time: i128,
+
+        pub fn next(self: *Self) ?*QueryType.EntityHandle {
+            if (self.isBudgetExhausted()) {
+                // Save where the next run continues.
+                if (self.inner.chunk_index < self.inner.chunks.len) {
+                    self.cursor.chunk = self.inner.chunks[self.inner.chunk_index];
+                    self.cursor.row = self.inner.entity_index;
+                }
+                return null;
+            }
+
+            if (self.inner.next()) |entity| {
+                self.processed += 1;
+                return entity;
+            }
+
+            self.cursor.* = .{ .passes = self.cursor.passes + 1 };
+            return null;
+        }
+
+        fn isBudgetExhausted(self: *const Self) bool {
+            if (budget.entities > 0 and self.processed >= budget.entities) {
+                return true;
+            }
+            if (budget.time_ns > 0 and self.processed > 0 and self.processed % time_check_interval == 0) {
+                return std.time.nanoTimestamp() - self.start_time >= budget.time_ns;
+            }
+            return false;
+        }
+    };
+
+    return struct {
+        const Self = @This();
+        pub const Type = SystemParameterType.Sliced;
+        pub const ComponentTypes = Components;
+        pub const EntityHandle = QueryType.EntityHandle;
+        pub const Iterator = SlicedIterator;
+
+        query: QueryType,
+        cursor: *SliceCursor,
+
+        pub fn deinit(self: *const Self) void {
+            self.query.deinit();
+        }
+
+        /// Only call once per run, every call continues at the saved cursor.
+        pub fn iter(self: *const Self) SlicedIterator {
+            var inner = self.query.iter();
+            if (self.cursor.chunk) |chunk| {
+                if (std.mem.indexOfScalar(*Chunk, self.query.chunks, chunk)) |chunk_index| {
+                    inner.seek(chunk_index, self.cursor.row);
+                }
+            }
+            return SlicedIterator{
+                .inner = inner,
+                .cursor = self.cursor,
+                .start_time = if (budget.time_ns > 0) std.time.nanoTimestamp() else 0,
+            };
+        }
+
+        /// Number of enabled entities matching the query, not only those of the current slice.
+        pub fn count(self: *const Self) u64 {
+            return self.query.count();
+        }
+    };
+}
+
+/// System parameter for components of an entity which has to be the only enabled one matching `Components`, e.g. the player.
+/// The entity is cached by the system and only searched again after it moved to another table,
+/// so resolving it costs O(matching tables) instead of building a chunk list.
+/// If not exactly one entity matches, the system is skipped for this run and `World.runStage` logs
+/// `error.SingleNotFound` or `error.SingleNotUnique`.
+pub fn Single(comptime Components: anytype) type {
+    return struct {
+        const Self = @This();
+        pub const Type = SystemParameterType.Single;
+        pub const ComponentTypes = Components;
+        pub const EntityHandle = getEntityHandle(Components);
+
+        entity: EntityHandle,
+
+        pub fn get(self: *const Self) *const EntityHandle {
+            return &self.entity;
+        }
+    };
+}
+
 fn getNumSizedTypes(comptime T: anytype) u64 {
     const typeInfo = @typeInfo(@TypeOf(T)).Struct;
     return typeInfo.fields.len;
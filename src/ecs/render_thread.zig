@@ -0,0 +1,101 @@
+//! Runs the `Render` stage of a world on a long-lived thread, so it can overlap the frame systems of the next frame.
+//! The thread sleeps between frames instead of being spawned for every frame.
+
+const std = @import("std");
+
+const World = @import("world.zig");
+
+const Self = @This();
+
+allocator: std.mem.Allocator,
+world: *World,
+thread: std.Thread,
+
+mutex: std.Thread.Mutex = .{},
+start_condition: std.Thread.Condition = .{},
+done_condition: std.Thread.Condition = .{},
+
+/// Incremented by `start`, the thread waits until it changes.
+generation: u64 = 0,
+running: bool = false,
+quit: bool = false,
+
+result: ?anyerror = null,
+
+pub fn init(allocator: std.mem.Allocator, world: *World) !*Self {
+    var self = try allocator.create(Self);
+    errdefer allocator.destroy(self);
+
+    self.* = Self{
+        .allocator = allocator,
+        .world = world,
+        .thread = undefined,
+    };
+    self.thread = try std.Thread.spawn(.{}, threadMain, .{self});
+
+    return self;
+}
+
+/// Waits for the current run to finish.
+pub fn deinit(self: *Self) void {
+    self.mutex.lock();
+    while (self.running) {
+        self.done_condition.wait(&self.mutex);
+    }
+    self.quit = true;
+    self.start_condition.broadcast();
+    self.mutex.unlock();
+
+    self.thread.join();
+    self.allocator.destroy(self);
+}
+
+/// Starts running the render systems, `wait` has to be called before the next `start`.
+pub fn start(self: *Self) void {
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    std.debug.assert(!self.running);
+    self.running = true;
+    self.result = null;
+    self.generation += 1;
+    self.start_condition.signal();
+}
+
+/// Blocks until the run started by `start` is done and returns its error.
+pub fn wait(self: *Self) !void {
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    while (self.running) {
+        self.done_condition.wait(&self.mutex);
+    }
+
+    if (self.result) |err| {
+        return err;
+    }
+}
+
+fn threadMain(self: *Self) void {
+    var generation: u64 = 0;
+    while (true) {
+        self.mutex.lock();
+        while (self.generation == generation and !self.quit) {
+            self.start_condition.wait(&self.mutex);
+        }
+        if (self.quit) {
+            self.mutex.unlock();
+            return;
+        }
+        generation = self.generation;
+        self.mutex.unlock();
+
+        const result = self.world.runRenderSystems();
+
+        self.mutex.lock();
+        self.result = if (result) |_| null else |err| err;
+        self.running = false;
+        self.done_condition.signal();
+        self.mutex.unlock();
+    }
+}
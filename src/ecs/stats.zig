@@ -0,0 +1,240 @@
+const std = @import("std");
+
+const ArchetypeTable = @import("archetype_table.zig");
+const Chunk = @import("chunk.zig");
+const Entity = @import("entity.zig");
+const EntityRef = Entity.Ref;
+
+const Rtti = @import("../util/rtti.zig");
+
+/// Counters maintained by the world while it runs.
+/// `frame_*` values are for the current frame and get moved into `last_frame_*` by `World.endFrame`.
+pub const WorldCounters = struct {
+    frame: u64 = 0,
+
+    /// Entities created, destroyed or moved between archetype tables.
+    structural_changes: u64 = 0,
+    frame_structural_changes: u64 = 0,
+    last_frame_structural_changes: u64 = 0,
+
+    /// Commands applied through `Commands.applyCommands`.
+    commands_applied: u64 = 0,
+    frame_commands_applied: u64 = 0,
+    last_frame_commands_applied: u64 = 0,
+
+    pub fn recordStructuralChange(self: *@This()) void {
+        self.structural_changes += 1;
+        self.frame_structural_changes += 1;
+    }
+
+    pub fn recordStructuralChanges(self: *@This(), count: u64) void {
+        self.structural_changes += count;
+        self.frame_structural_changes += count;
+    }
+
+    pub fn recordCommands(self: *@This(), count: u64) void {
+        self.commands_applied += count;
+        self.frame_commands_applied += count;
+    }
+
+    pub fn endFrame(self: *@This()) void {
+        self.frame += 1;
+        self.last_frame_structural_changes = self.frame_structural_changes;
+        self.frame_structural_changes = 0;
+        self.last_frame_commands_applied = self.frame_commands_applied;
+        self.frame_commands_applied = 0;
+    }
+};
+
+/// Counters maintained by each archetype table.
+pub const TableCounters = struct {
+    chunks: u64 = 0,
+    capacity: u64 = 0,
+    bytes_reserved: u64 = 0,
+
+    /// Entities moved into/out of this table by adding or removing components.
+    frame_moves_in: u64 = 0,
+    frame_moves_out: u64 = 0,
+    last_frame_moves_in: u64 = 0,
+    last_frame_moves_out: u64 = 0,
+
+    pub fn recordChunk(self: *@This(), chunk: *const Chunk) void {
+        self.chunks += 1;
+        self.capacity += chunk.capacity;
+        self.bytes_reserved += chunk.pool.len;
+    }
+
+    pub fn endFrame(self: *@This()) void {
+        self.last_frame_moves_in = self.frame_moves_in;
+        self.last_frame_moves_out = self.frame_moves_out;
+        self.frame_moves_in = 0;
+        self.frame_moves_out = 0;
+    }
+};
+
+/// Counters of one parameter of a system, only used for query parameters.
+pub const QueryCounters = struct {
+    is_query: bool = false,
+
+    /// Enabled entities and chunks matched by the query in the last run.
+    entities: u64 = 0,
+    chunks: u64 = 0,
+};
+
+/// Counters maintained for each system by `World.runStage`.
+pub const SystemCounters = struct {
+    runs: u64 = 0,
+    /// Runs skipped because of the system's run criteria or a `Single` parameter without exactly one entity.
+    skipped: u64 = 0,
+
+    /// Duration of the last run in nanoseconds.
+    last_time_ns: u64 = 0,
+    total_time_ns: u64 = 0,
+
+    /// Commands added to the `Commands` resource during the last run.
+    last_commands: u64 = 0,
+
+    pub fn recordRun(self: *@This(), time_ns: u64, commands: u64) void {
+        self.runs += 1;
+        self.last_time_ns = time_ns;
+        self.total_time_ns += time_ns;
+        self.last_commands = commands;
+    }
+
+    pub fn recordSkip(self: *@This()) void {
+        self.skipped += 1;
+        self.last_time_ns = 0;
+        self.last_commands = 0;
+    }
+};
+
+pub const ComponentStats = struct {
+    component_type: Rtti.TypeId,
+    bytes_used: u64,
+    bytes_reserved: u64,
+};
+
+pub const TableStats = struct {
+    table: *ArchetypeTable,
+    rows: u64,
+    chunks: u64,
+    capacity: u64,
+    bytes_used: u64,
+    bytes_reserved: u64,
+    fill_ratio: f32,
+    moves_in: u64,
+    moves_out: u64,
+    components: []ComponentStats,
+
+    pub fn compareRows(context: void, lhs: @This(), rhs: @This()) bool {
+        _ = context;
+        return lhs.rows > rhs.rows;
+    }
+};
+
+/// Snapshot of the memory usage of a world, created by `World.stats`.
+pub const WorldStats = struct {
+    const Self = @This();
+
+    allocator: std.mem.Allocator,
+    frame: u64,
+    entities: u64 = 0,
+    bytes_used: u64 = 0,
+    bytes_reserved: u64 = 0,
+    structural_changes: u64,
+    last_frame_structural_changes: u64,
+    commands_applied: u64,
+    last_frame_commands_applied: u64,
+    tables: []TableStats,
+
+    pub fn init(allocator: std.mem.Allocator, tables: []const *ArchetypeTable, counters: WorldCounters) !Self {
+        var result = Self{
+            .allocator = allocator,
+            .frame = counters.frame,
+            .structural_changes = counters.structural_changes,
+            .last_frame_structural_changes = counters.last_frame_structural_changes,
+            .commands_applied = counters.commands_applied,
+            .last_frame_commands_applied = counters.last_frame_commands_applied,
+            .tables = try allocator.alloc(TableStats, tables.len),
+        };
+        var filled: usize = 0;
+        errdefer {
+            for (result.tables[0..filled]) |*table| {
+                allocator.free(table.components);
+            }
+            allocator.free(result.tables);
+        }
+
+        for (tables) |table, i| {
+            const rows = table.getEntityCount();
+            const components = try allocator.alloc(ComponentStats, table.firstChunk.components.len);
+
+            var row_size: u64 = @sizeOf(EntityRef);
+            for (table.firstChunk.components) |*component_list, k| {
+                const size = component_list.componentType.typeInfo.size;
+                row_size += size;
+                components[k] = .{
+                    .component_type = component_list.componentType,
+                    .bytes_used = rows * size,
+                    .bytes_reserved = table.counters.capacity * size,
+                };
+            }
+
+            const bytes_used = rows * row_size;
+            result.tables[i] = .{
+                .table = table,
+                .rows = rows,
+                .chunks = table.counters.chunks,
+                .capacity = table.counters.capacity,
+                .bytes_used = bytes_used,
+                .bytes_reserved = table.counters.bytes_reserved,
+                .fill_ratio = if (table.counters.capacity > 0) @intToFloat(f32, rows) / @intToFloat(f32, table.counters.capacity) else 0,
+                .moves_in = table.counters.last_frame_moves_in,
+                .moves_out = table.counters.last_frame_moves_out,
+                .components = components,
+            };
+            filled += 1;
+
+            // The entities in a group storage are already counted in their archetype tables.
+            if (!table.is_group_storage) {
+                result.entities += rows;
+            }
+            result.bytes_used += bytes_used;
+            result.bytes_reserved += table.counters.bytes_reserved;
+        }
+
+        return result;
+    }
+
+    pub fn deinit(self: *const Self) void {
+        for (self.tables) |*table| {
+            self.allocator.free(table.components);
+        }
+        self.allocator.free(self.tables);
+    }
+
+    /// Sorts the tables by number of rows, largest first.
+    pub fn sortByRows(self: *Self) void {
+        std.sort.sort(TableStats, self.tables, {}, TableStats.compareRows);
+    }
+
+    /// Writes the stats as a single line of JSON, so a session can be dumped as one object per frame.
+    pub fn writeJson(self: *const Self, writer: anytype) !void {
+        try std.fmt.format(writer, "{{\"frame\":{},\"entities\":{},\"bytes_used\":{},\"bytes_reserved\":{}", .{ self.frame, self.entities, self.bytes_used, self.bytes_reserved });
+        try std.fmt.format(writer, ",\"structural_changes\":{},\"frame_structural_changes\":{}", .{ self.structural_changes, self.last_frame_structural_changes });
+        try std.fmt.format(writer, ",\"commands_applied\":{},\"frame_commands_applied\":{}", .{ self.commands_applied, self.last_frame_commands_applied });
+        try writer.writeAll(",\"tables\":[");
+        for (self.tables) |*table, i| {
+            if (i > 0) try writer.writeAll(",");
+            try std.fmt.format(writer, "{{\"archetype\":\"{}\",\"group_storage\":{},\"rows\":{},\"chunks\":{},\"capacity\":{}", .{ table.table.archetype, table.table.is_group_storage, table.rows, table.chunks, table.capacity });
+            try std.fmt.format(writer, ",\"bytes_used\":{},\"bytes_reserved\":{},\"fill_ratio\":{d:.4}", .{ table.bytes_used, table.bytes_reserved, table.fill_ratio });
+            try std.fmt.format(writer, ",\"moves_in\":{},\"moves_out\":{},\"components\":[", .{ table.moves_in, table.moves_out });
+            for (table.components) |*component, k| {
+                if (k > 0) try writer.writeAll(",");
+                try std.fmt.format(writer, "{{\"type\":\"{}\",\"bytes_used\":{},\"bytes_reserved\":{}}}", .{ component.component_type, component.bytes_used, component.bytes_reserved });
+            }
+            try writer.writeAll("]}");
+        }
+        try writer.writeAll("]}\n");
+    }
+};
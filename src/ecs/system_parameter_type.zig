@@ -1,3 +1,6 @@
 pub const SystemParameterType = enum {
     Query,
+    Observer,
+    Single,
+    Sliced,
 };
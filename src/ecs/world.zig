@@ -1,34 +1,144 @@
 const std = @import("std");
 
 const ArchetypeTable = @import("archetype_table.zig");
+const ArchetypeTableMap = @import("archetype_table_map.zig");
 const Chunk = @import("chunk.zig");
+const Commands = @import("commands.zig");
 const Archetype = @import("archetype.zig");
 const Entity = @import("entity.zig");
 const EntityRef = Entity.Ref;
 const DotPrinter = @import("dot_printer.zig");
+const Group = @import("group.zig");
 const Query = @import("query.zig").Query;
+const SliceCursor = @import("query.zig").SliceCursor;
+const ObserverKind = @import("observer.zig").ObserverKind;
+const ObserverSet = @import("observer.zig").ObserverSet;
 const SystemParameterType = @import("system_parameter_type.zig").SystemParameterType;
+const Stats = @import("stats.zig");
 
 const Rtti = @import("../util/rtti.zig");
 const BitSet = @import("../util/bit_set.zig");
+const VirtualChunkAllocator = @import("../util/virtual_chunk_allocator.zig").VirtualChunkAllocator;
 
 // const Profiler = @import("../editor/profiler.zig");
 
 pub const EntityId = u64;
 pub const ComponentId = u64;
 
+/// Conditions under which a system is skipped, checked before any parameter is built.
+/// A system runs only if none of the set conditions say to skip it.
+pub const RunCriteria = struct {
+    /// Skip if none of the query parameters match an enabled entity. Systems without query parameters always run.
+    skip_if_queries_empty: bool = false,
+
+    /// Skip unless a table matched by a query parameter changed structurally (entities added, removed or moved)
+    /// or a new matching table was created since the last run. Enabling or disabling entities doesn't count.
+    skip_if_tables_unchanged: bool = false,
+
+    /// Skip unless the resource with this `Rtti.typeIndex` was marked changed since the last run, see `markResourceChanged`.
+    resource_changed: ?u32 = null,
+};
+
 const System = struct {
-    const InvokeFunction = fn (world: *Self) anyerror!void;
+    /// Returns false if the system was skipped because of its `RunCriteria`.
+    const InvokeFunction = fn (world: *Self, state: *anyopaque) anyerror!bool;
+    const DeinitFunction = fn (world: *Self, state: *anyopaque) void;
 
     name: [*:0]const u8,
     invoke: InvokeFunction,
+    deinit: DeinitFunction,
+
+    /// Created in `addSystem` and kept until the world is destroyed, see `SystemState`.
+    state: *anyopaque,
     enabled: bool = true,
+    /// Last `Single` error of the system, so it is only logged when it changes instead of every frame.
+    single_error: ?anyerror = null,
+
+    counters: Stats.SystemCounters = .{},
+    /// Indexed by parameter, points into the state.
+    query_counters: []Stats.QueryCounters,
+
+    /// Sum of the entities matched by all query parameters in the last run.
+    pub fn getLastEntityCount(self: *const System) u64 {
+        var result: u64 = 0;
+        for (self.query_counters) |*query_counters| {
+            result += query_counters.entities;
+        }
+        return result;
+    }
 };
 
-const ComponentInfo = struct {
-    id: u64,
+/// Systems run in stages, in the order of this enum. `runFrameSystems` runs all stages before `Render`.
+pub const Stage = enum {
+    PreUpdate,
+    Update,
+    PostUpdate,
+    /// Copies everything render systems need out of the world into resources.
+    Extract,
+    /// Systems in this stage should only read resources written by `Extract`, not entities,
+    /// so they can run on another thread while the next frame is simulated.
+    Render,
 };
 
+const stage_count = @typeInfo(Stage).Enum.fields.len;
+
+const StageSystems = struct {
+    systems: std.ArrayList(System),
+
+    /// If set the `Commands` resource is applied after all systems of the stage ran,
+    /// so later stages see entities and components created by this stage in the same frame.
+    flush_commands: bool,
+};
+
+/// Matches of a query parameter, kept between runs of a system.
+/// The matching tables are only collected again after new tables or groups were created,
+/// the chunk list is rebuilt every run but reuses its memory.
+const QueryCache = struct {
+    tables_version: ?u64 = null,
+    tables: std.ArrayListUnmanaged(*ArchetypeTable) = .{},
+    chunks: std.ArrayListUnmanaged(*Chunk) = .{},
+
+    fn deinit(self: *@This(), allocator: std.mem.Allocator) void {
+        self.tables.deinit(allocator);
+        self.chunks.deinit(allocator);
+    }
+};
+
+/// Entity matched by a `Single` parameter, kept between runs of a system.
+/// The entity is only searched again when it is not in `table` anymore (moved or destroyed).
+const SingleCache = struct {
+    tables_version: ?u64 = null,
+    tables: std.ArrayListUnmanaged(*ArchetypeTable) = .{},
+    entity: EntityRef = .{},
+    table: ?*ArchetypeTable = null,
+
+    fn deinit(self: *@This(), allocator: std.mem.Allocator) void {
+        self.tables.deinit(allocator);
+    }
+};
+
+/// Persistent state of a system. Index i belongs to parameter i, unused entries stay empty.
+fn SystemState(comptime system: anytype) type {
+    const param_count = @typeInfo(std.meta.ArgsTuple(@TypeOf(system))).Struct.fields.len;
+    return struct {
+        queries: [param_count]QueryCache = [_]QueryCache{.{}} ** param_count,
+        singles: [param_count]SingleCache = [_]SingleCache{.{}} ** param_count,
+
+        /// Resources are never removed, so pointers stay valid once resolved.
+        resources: [param_count]?*u8 = [_]?*u8{null} ** param_count,
+
+        query_counters: [param_count]Stats.QueryCounters = [_]Stats.QueryCounters{.{}} ** param_count,
+        slice_cursors: [param_count]SliceCursor = [_]SliceCursor{.{}} ** param_count,
+        /// Observer ids of `Added`/`Removed` parameters.
+        observers: [param_count]usize = [_]usize{0} ** param_count,
+
+        criteria: RunCriteria = .{},
+        /// Values seen by the last run, used to check `criteria`.
+        last_tables_version: ?u64 = null,
+        last_resource_version: ?u64 = null,
+    };
+}
+
 const IntContext = struct {
     pub fn hash(ctx: @This(), key: u64) u64 {
         _ = ctx;
@@ -47,34 +157,47 @@ const IntContext = struct {
 
 const EntityMap = std.HashMap(u64, *Entity, std.hash_map.AutoContext(u64), 10);
 
-// Every action which modifies entities in a way which invalidates
-// e.g. iterators or direct pointers to components should increment the version.
-version: u128 = 0,
-
 allocator: std.mem.Allocator,
 globalPool: std.heap.ArenaAllocator,
 entityArena: std.heap.ArenaAllocator,
 resourceAllocator: std.heap.ArenaAllocator,
+chunkAllocator: VirtualChunkAllocator,
 
-archetypeTables: std.HashMap(*ArchetypeTable, *ArchetypeTable, ArchetypeTable.HashTableContext, 80),
+archetypeTables: ArchetypeTableMap,
 archetypeTablesArray: std.ArrayList(*ArchetypeTable),
 baseArchetypeTable: *ArchetypeTable,
+groups: std.ArrayList(*Group),
 entityPool: std.ArrayList(*Entity),
 
 nextEntityId: EntityId = 1,
-components: std.AutoHashMap(Rtti.TypeId, ComponentInfo),
+/// Indexed by Rtti.TypeInfo.index, `no_component_id` for types which are not used as components in this world.
+typeIndexToComponentId: std.ArrayList(ComponentId),
 componentIdToComponentType: std.ArrayList(Rtti.TypeId),
-frameSystems: std.ArrayList(System),
-renderSystems: std.ArrayList(System),
+stages: [stage_count]StageSystems,
 
 //  We store pointers to external resources (managed outside of world)
 // and internal resources (managed by this world) in here.
 // Internal resources are allocated using .resourceAllocator
 // and are not freed individually, so this is fine.
-resources: std.AutoHashMap(Rtti.TypeId, *u8),
+// Indexed by Rtti.typeIndex of the resource type.
+resources: std.ArrayList(?*u8),
+/// Incremented by `markResourceChanged`, indexed like `resources`.
+resource_versions: std.ArrayList(u64),
 
 entity_maps_mask: u64 = 0,
 
+/// Incremented whenever an archetype table or a group is created.
+tables_version: u64 = 0,
+
+/// Number of entities in all archetype tables.
+entity_count: u64 = 0,
+
+/// Entities which got observed components added/removed, see `observe`.
+added_observers: ObserverSet,
+removed_observers: ObserverSet,
+
+counters: Stats.WorldCounters = .{},
+
 const Self = @This();
 
 pub fn init(allocator: std.mem.Allocator) !*Self {
@@ -86,16 +209,29 @@ pub fn init(allocator: std.mem.Allocator) !*Self {
         .globalPool = std.heap.ArenaAllocator.init(allocator),
         .entityArena = std.heap.ArenaAllocator.init(allocator),
         .resourceAllocator = std.heap.ArenaAllocator.init(allocator),
-        .archetypeTables = @TypeOf(world.archetypeTables).init(allocator),
+        .chunkAllocator = VirtualChunkAllocator.init(allocator, VirtualChunkAllocator.default_reserve_size),
+        .archetypeTables = try ArchetypeTableMap.init(allocator),
         .archetypeTablesArray = @TypeOf(world.archetypeTablesArray).init(allocator),
+        .groups = @TypeOf(world.groups).init(allocator),
         .entityPool = @TypeOf(world.entityPool).init(allocator),
-        .components = @TypeOf(world.components).init(allocator),
+        .typeIndexToComponentId = @TypeOf(world.typeIndexToComponentId).init(allocator),
         .componentIdToComponentType = @TypeOf(world.componentIdToComponentType).init(allocator),
-        .frameSystems = @TypeOf(world.frameSystems).init(allocator),
-        .renderSystems = @TypeOf(world.renderSystems).init(allocator),
+        .stages = undefined,
         .resources = @TypeOf(world.resources).init(allocator),
+        .resource_versions = @TypeOf(world.resource_versions).init(allocator),
+        .added_observers = ObserverSet.init(allocator),
+        .removed_observers = ObserverSet.init(allocator),
     };
 
+    for (world.stages) |*stage, i| {
+        stage.* = .{
+            .systems = std.ArrayList(System).init(allocator),
+            // Flushing between update stages makes spawns visible to later stages, e.g. physics sees new projectiles.
+            // Render and PostUpdate are flushed by the final `applyCommands` of the frame.
+            .flush_commands = @intToEnum(Stage, i) == .PreUpdate or @intToEnum(Stage, i) == .Update,
+        };
+    }
+
     // Create archetype table for empty entities.
     var archetype = try world.createArchetypeStruct(.{});
     world.baseArchetypeTable = try world.getOrCreateArchetypeTable(archetype);
@@ -104,31 +240,41 @@ pub fn init(allocator: std.mem.Allocator) !*Self {
 }
 
 pub fn deinit(self: *Self) void {
-    var iter = self.archetypeTables.valueIterator();
-    while (iter.next()) |table| {
-        table.*.deinit();
+    for (self.archetypeTablesArray.items) |table| {
+        table.deinit();
+    }
+    for (self.groups.items) |group| {
+        group.deinit();
+    }
+    self.chunkAllocator.deinit();
+    for (self.stages) |*stage| {
+        for (stage.systems.items) |*system| {
+            system.deinit(self, system.state);
+        }
+        stage.systems.deinit();
     }
-    self.frameSystems.deinit();
-    self.renderSystems.deinit();
     self.archetypeTables.deinit();
     self.archetypeTablesArray.deinit();
+    self.groups.deinit();
     self.globalPool.deinit();
     self.resourceAllocator.deinit();
     self.entityPool.deinit();
     self.entityArena.deinit();
-    self.components.deinit();
+    self.typeIndexToComponentId.deinit();
     self.componentIdToComponentType.deinit();
     self.resources.deinit();
+    self.resource_versions.deinit();
+    self.added_observers.deinit();
+    self.removed_observers.deinit();
     self.allocator.destroy(self);
 }
 
 pub fn dump(self: *Self) void {
     std.debug.print("------------------------- dump -------------------------------\n", .{});
-    var tableIter = self.archetypeTables.iterator();
-    while (tableIter.next()) |entry| {
-        std.debug.print("  {}\n", .{entry.value_ptr.*});
+    for (self.archetypeTablesArray.items) |table| {
+        std.debug.print("  {}\n", .{table});
 
-        var chunk: ?*Chunk = entry.value_ptr.*.firstChunk;
+        var chunk: ?*Chunk = table.firstChunk;
         while (chunk) |c| {
             defer chunk = c.next;
             std.debug.print("    ", .{});
@@ -145,6 +291,35 @@ pub fn dump(self: *Self) void {
     std.debug.print("--------------------------------------------------------------\n", .{});
 }
 
+/// Collects memory and fragmentation statistics for every archetype table and group storage.
+/// The result has to be freed with `deinit`.
+pub fn stats(self: *Self, allocator: std.mem.Allocator) !Stats.WorldStats {
+    var tables = try std.ArrayList(*ArchetypeTable).initCapacity(allocator, self.archetypeTablesArray.items.len + self.groups.items.len);
+    defer tables.deinit();
+
+    tables.appendSliceAssumeCapacity(self.archetypeTablesArray.items);
+    for (self.groups.items) |group| {
+        tables.appendAssumeCapacity(&group.storage);
+    }
+
+    return Stats.WorldStats.init(allocator, tables.items, self.counters);
+}
+
+/// Moves the per frame counters of the world and all tables into their `last_frame_*` counterparts
+/// and delivers the observer events recorded during this frame.
+pub fn endFrame(self: *Self) void {
+    self.counters.endFrame();
+    self.added_observers.endFrame() catch |err| {
+        std.log.err("Failed to deliver observer events: {}", .{err});
+    };
+    self.removed_observers.endFrame() catch |err| {
+        std.log.err("Failed to deliver observer events: {}", .{err});
+    };
+    for (self.archetypeTablesArray.items) |table| {
+        table.counters.endFrame();
+    }
+}
+
 pub fn dumpGraph(self: *Self) !void {
     var graphFile = try std.fs.cwd().createFile("graph.gv", .{});
     defer graphFile.close();
@@ -154,117 +329,395 @@ pub fn dumpGraph(self: *Self) !void {
     try dotPrinter.printGraph(graphFile.writer(), self);
 }
 
+/// Destroys all entities. Observers get a `Removed` event for every component of every entity.
 pub fn clear(self: *Self) !void {
     for (self.archetypeTablesArray.items) |table| {
         var chunk: ?*Chunk = table.firstChunk;
         while (chunk) |c| {
+            try self.removed_observers.recordAll(table.archetype.components, c.entity_refs[0..c.count]);
             for (c.entity_refs[0..c.count]) |*ref| {
                 try self.entityPool.append(ref.entity);
             }
 
             c.count = 0;
+            c.disabled_count = 0;
+            c.bumpVersion();
+            chunk = c.next;
+        }
+        table.entity_count = 0;
+        table.disabled_count = 0;
+    }
+
+    for (self.groups.items) |group| {
+        var chunk: ?*Chunk = group.storage.firstChunk;
+        while (chunk) |c| {
+            c.count = 0;
+            c.disabled_count = 0;
+            c.bumpVersion();
             chunk = c.next;
         }
+        group.storage.entity_count = 0;
+        group.storage.disabled_count = 0;
+    }
+
+    self.entity_count = 0;
+}
+
+/// Returns the slot for the resource type, growing the slot array if necessary.
+fn getResourceSlot(self: *Self, comptime ResourceType: type) !*?*u8 {
+    const index = Rtti.typeIndex(ResourceType);
+    if (index >= self.resources.items.len) {
+        // Both arrays grow before either is appended to, so they keep the same length if an allocation fails.
+        const new_count = index + 1 - self.resources.items.len;
+        try self.resource_versions.ensureTotalCapacity(index + 1);
+        try self.resources.ensureTotalCapacity(index + 1);
+        self.resource_versions.appendNTimesAssumeCapacity(0, new_count);
+        self.resources.appendNTimesAssumeCapacity(null, new_count);
+    }
+    return &self.resources.items[index];
+}
+
+/// Lets systems with `RunCriteria.resource_changed` set to this resource run again.
+pub fn markResourceChanged(self: *Self, comptime ResourceType: type) void {
+    const index = Rtti.typeIndex(ResourceType);
+    if (index < self.resource_versions.items.len) {
+        self.resource_versions.items[index] += 1;
     }
 }
 
+fn getResourceVersion(self: *const Self, index: u32) u64 {
+    return if (index < self.resource_versions.items.len) self.resource_versions.items[index] else 0;
+}
+
 pub fn addResourcePtr(self: *Self, resource: anytype) !void {
     const ResourceType = @TypeOf(resource.*);
-    const rtti = Rtti.typeId(ResourceType);
+    const slot = try self.getResourceSlot(ResourceType);
 
-    if (self.resources.contains(rtti)) {
+    if (slot.* != null) {
         return error.ResourceAlreadyExists;
     }
 
-    try self.resources.put(rtti, @ptrCast(*u8, resource));
+    slot.* = @ptrCast(*u8, resource);
 }
 
 pub fn addResource(self: *Self, resource: anytype) !*@TypeOf(resource) {
     const ResourceType = @TypeOf(resource);
-    const rtti = Rtti.typeId(ResourceType);
+    const slot = try self.getResourceSlot(ResourceType);
 
-    if (self.resources.contains(rtti)) {
+    if (slot.* != null) {
         return error.ResourceAlreadyExists;
     }
 
     var newResource = try self.resourceAllocator.allocator().create(ResourceType);
     newResource.* = resource;
 
-    try self.resources.put(rtti, @ptrCast(*u8, newResource));
+    slot.* = @ptrCast(*u8, newResource);
 
     return newResource;
 }
 
 pub fn getResource(self: *Self, comptime ResourceType: type) !*ResourceType {
-    const rtti = Rtti.typeId(ResourceType);
-    const resourcePtr = self.resources.get(rtti) orelse return error.ResourceNotFound;
+    const index = Rtti.typeIndex(ResourceType);
+    if (index >= self.resources.items.len) {
+        return error.ResourceNotFound;
+    }
+    const resourcePtr = self.resources.items[index] orelse return error.ResourceNotFound;
     return @ptrCast(*ResourceType, @alignCast(@alignOf(ResourceType), resourcePtr));
 }
 
 pub fn query(self: *Self, comptime Components: anytype) !Query(Components) {
     const archetype = try self.createArchetypeStruct(Components);
+
+    var tables = std.ArrayListUnmanaged(*ArchetypeTable){};
+    defer tables.deinit(self.allocator);
+    try self.getTablesForQuery(archetype, &tables);
+
+    var chunks = std.ArrayListUnmanaged(*Chunk){};
+    errdefer chunks.deinit(self.allocator);
+    for (tables.items) |table| {
+        try appendChunks(self.allocator, &chunks, table);
+    }
+    return Query(Components).init(self.allocator, self, tables.toOwnedSlice(self.allocator), chunks.toOwnedSlice(self.allocator), true);
+}
+
+/// Declares an owning group for the given components.
+/// Entities which have all of them keep these components packed in one table owned by the group,
+/// so queries over (a subset of) the owned components iterate that table instead of every matching archetype table.
+/// Queries which also use other components look the owned components up per entity.
+/// A component can only be owned by one group, and groups have to be declared
+/// before an archetype table containing all owned components exists (i.e. before any matching entity or query).
+pub fn addGroup(self: *Self, comptime Components: anytype) !*Group {
+    const archetype = try self.createArchetypeStruct(Components);
+    if (archetype.components.bitSet.count() == 0) {
+        return error.EmptyGroup;
+    }
+
+    for (self.groups.items) |other| {
+        var shared = other.components;
+        shared.setIntersection(archetype.components);
+        if (shared.bitSet.count() > 0) {
+            return error.ComponentAlreadyOwnedByGroup;
+        }
+    }
+
+    for (self.archetypeTablesArray.items) |table| {
+        if (table.archetype.components.isSuperSetOf(archetype.components)) {
+            return error.GroupDeclaredAfterTable;
+        }
+    }
+
+    var group = try self.globalPool.allocator().create(Group);
+    try group.init(try archetype.clone(), self.allocator, self.chunkAllocator.allocator());
+    try self.groups.append(group);
+    self.tables_version += 1;
+    return group;
+}
+
+/// Returns the group which owns all of the given components, if any.
+fn getOwningGroup(self: *Self, components: BitSet) ?*Group {
+    if (components.bitSet.count() == 0) {
+        return null;
+    }
+    for (self.groups.items) |group| {
+        if (components.isSubSetOf(group.components)) {
+            return group;
+        }
+    }
+    return null;
+}
+
+/// Collects all tables containing entities which have all components of 'archetype'.
+/// If one group owns all these components its storage replaces the tables belonging to that group.
+fn getTablesForQuery(self: *Self, archetype: Archetype, result: *std.ArrayListUnmanaged(*ArchetypeTable)) !void {
+    result.clearRetainingCapacity();
+
+    const group = self.getOwningGroup(archetype.components);
+    if (group) |g| {
+        try result.append(self.allocator, &g.storage);
+    }
+
     var tables = try self.getDirectSupersetTables(archetype);
     defer tables.deinit();
-    var chunks = std.ArrayList(*Chunk).init(self.allocator);
     for (tables.items) |table| {
-        var chunk = table.firstChunk;
-        while (true) {
-            if (chunk.count > 0) {
-                try chunks.append(chunk);
-            }
-            if (chunk.next) |next| {
-                chunk = next;
-            } else {
-                break;
-            }
+        if (group == null or table.group != group) {
+            try result.append(self.allocator, table);
         }
     }
-    return Query(Components).init(chunks.allocator, self, chunks.items, true);
 }
 
-pub fn runFrameSystems(self: *Self) !void {
-    for (self.frameSystems.items) |*system| {
-        if (system.enabled) {
-            try system.invoke(self);
+/// Appends all chunks of the table which contain enabled entities.
+fn appendChunks(allocator: std.mem.Allocator, chunks: *std.ArrayListUnmanaged(*Chunk), table: *ArchetypeTable) !void {
+    var chunk: ?*Chunk = table.firstChunk;
+    while (chunk) |c| {
+        if (c.count > c.disabled_count) {
+            try chunks.append(allocator, c);
         }
+        chunk = c.next;
     }
 }
 
-pub fn runRenderSystems(self: *Self) !void {
-    for (self.renderSystems.items) |*system| {
+/// Starts recording which entities get the component added/removed and returns the id of the new observer.
+/// The entities are delivered after `endFrame` through `getObservedEntities` and kept until the observer consumes them.
+pub fn observe(self: *Self, kind: ObserverKind, component_type: Rtti.TypeId) !usize {
+    const component_id = try self.getComponentIdForRtti(component_type);
+    return switch (kind) {
+        .Added => try self.added_observers.observe(component_id),
+        .Removed => try self.removed_observers.observe(component_id),
+    };
+}
+
+/// Returns the entities which got the component added/removed since the observer last called `consumeObservedEntities`.
+pub fn getObservedEntities(self: *Self, kind: ObserverKind, component_type: Rtti.TypeId, observer: usize) ![]const EntityRef {
+    const component_id = try self.getComponentIdForRtti(component_type);
+    return switch (kind) {
+        .Added => self.added_observers.getPending(component_id, observer),
+        .Removed => self.removed_observers.getPending(component_id, observer),
+    };
+}
+
+/// Marks the entities returned by `getObservedEntities` as seen, called after a system with an observer parameter ran.
+pub fn consumeObservedEntities(self: *Self, kind: ObserverKind, component_type: Rtti.TypeId, observer: usize) !void {
+    const component_id = try self.getComponentIdForRtti(component_type);
+    switch (kind) {
+        .Added => self.added_observers.consume(component_id, observer),
+        .Removed => self.removed_observers.consume(component_id, observer),
+    }
+}
+
+/// Runs all systems of the stage and applies the `Commands` resource afterwards if the stage is a flush point.
+/// Every run is timed and counted in `System.counters`.
+pub fn runStage(self: *Self, stage: Stage) !void {
+    // Render systems can run concurrently with other stages which add commands, so they are not counted.
+    const commands = if (stage == .Render) null else self.getResource(Commands) catch null;
+
+    const stage_systems = &self.stages[@enumToInt(stage)];
+    for (stage_systems.systems.items) |*system| {
         if (system.enabled) {
-            try system.invoke(self);
+            const commands_before = if (commands) |c| c.commands.items.len else 0;
+            const start = std.time.nanoTimestamp();
+
+            // A missing or duplicated `Single` entity only skips this system, the rest of the frame still runs.
+            const ran = system.invoke(self, system.state) catch |err| switch (err) {
+                error.SingleNotFound, error.SingleNotUnique => {
+                    if (system.single_error == null or system.single_error.? != err) {
+                        std.log.warn("{s}: {}, skipping the system until it resolves", .{ system.name, err });
+                        system.single_error = err;
+                    }
+                    system.counters.recordSkip();
+                    continue;
+                },
+                else => return err,
+            };
+            system.single_error = null;
+            if (!ran) {
+                system.counters.recordSkip();
+                continue;
+            }
+
+            const time_ns = @intCast(u64, std.math.max(std.time.nanoTimestamp() - start, 0));
+            const commands_after = if (commands) |c| c.commands.items.len else 0;
+            system.counters.recordRun(time_ns, commands_after -| commands_before);
+        }
+    }
+
+    if (stage_systems.flush_commands) {
+        if (commands) |c| {
+            try c.applyCommands();
+        }
+    }
+}
+
+/// Writes the counters of the last run of every system as a single line of JSON, see `Stats.WorldStats.writeJson`.
+pub fn writeSystemsJson(self: *const Self, writer: anytype) !void {
+    try std.fmt.format(writer, "{{\"frame\":{},\"systems\":[", .{self.counters.frame});
+    var first = true;
+    for (self.stages) |*stage, stage_index| {
+        for (stage.systems.items) |*system| {
+            if (!first) try writer.writeAll(",");
+            first = false;
+
+            try std.fmt.format(writer, "{{\"name\":\"{s}\",\"stage\":\"{s}\",\"enabled\":{}", .{ system.name, @tagName(@intToEnum(Stage, stage_index)), system.enabled });
+            try std.fmt.format(writer, ",\"time_ns\":{},\"entities\":{},\"commands\":{},\"queries\":[", .{ system.counters.last_time_ns, system.getLastEntityCount(), system.counters.last_commands });
+            var first_query = true;
+            for (system.query_counters) |*query_counters, param| {
+                if (!query_counters.is_query) continue;
+                if (!first_query) try writer.writeAll(",");
+                first_query = false;
+                try std.fmt.format(writer, "{{\"param\":{},\"entities\":{},\"chunks\":{}}}", .{ param, query_counters.entities, query_counters.chunks });
+            }
+            try writer.writeAll("]}");
         }
     }
+    try writer.writeAll("]}\n");
+}
+
+/// Runs all stages before `Render`.
+pub fn runFrameSystems(self: *Self) !void {
+    try self.runStage(.PreUpdate);
+    try self.runStage(.Update);
+    try self.runStage(.PostUpdate);
+    try self.runStage(.Extract);
+}
+
+/// Only runs the `Render` stage, see `Stage.Render` for running it on another thread.
+pub fn runRenderSystems(self: *Self) !void {
+    try self.runStage(.Render);
 }
 
+/// Sets whether commands are applied after the stage ran.
+pub fn setStageFlush(self: *Self, stage: Stage, flush_commands: bool) void {
+    self.stages[@enumToInt(stage)].flush_commands = flush_commands;
+}
+
+pub fn addSystemToStage(self: *Self, stage: Stage, comptime system: anytype, name: [*:0]const u8) !void {
+    try self.addSystemWithCriteria(stage, system, name, .{});
+}
+
+pub fn addSystemWithCriteria(self: *Self, stage: Stage, comptime system: anytype, name: [*:0]const u8, criteria: RunCriteria) !void {
+    try self.stages[@enumToInt(stage)].systems.append(try self.createSystem(system, name, criteria));
+}
+
+/// Adds the system to the `Update` stage.
 pub fn addSystem(self: *Self, comptime system: anytype, name: [*:0]const u8) !void {
-    const wrapper = try createSystemInvokeFunction(system);
-    try self.frameSystems.append(.{
-        .name = name,
-        .invoke = wrapper,
-        .enabled = true,
-    });
+    try self.addSystemToStage(.Update, system, name);
 }
 
 pub fn addRenderSystem(self: *Self, comptime system: anytype, name: [*:0]const u8) !void {
-    const wrapper = try createSystemInvokeFunction(system);
-    try self.renderSystems.append(.{
+    try self.addSystemToStage(.Render, system, name);
+}
+
+fn createSystem(self: *Self, comptime system: anytype, name: [*:0]const u8, criteria: RunCriteria) !System {
+    const State = SystemState(system);
+    var state = try self.allocator.create(State);
+    errdefer self.allocator.destroy(state);
+    state.* = .{ .criteria = criteria };
+
+    try self.observeSystemParameters(system, &state.observers);
+
+    inline for (@typeInfo(std.meta.ArgsTuple(@TypeOf(system))).Struct.fields) |field, i| {
+        const ParamType = field.field_type;
+        if (@typeInfo(ParamType) == .Struct and @hasDecl(ParamType, "Type")) {
+            state.query_counters[i].is_query = ParamType.Type == .Query or ParamType.Type == .Sliced;
+        }
+    }
+
+    const X = struct {
+        fn deinit(world: *Self, state_ptr: *anyopaque) void {
+            const s = @ptrCast(*State, @alignCast(@alignOf(State), state_ptr));
+            for (s.queries) |*query_cache| {
+                query_cache.deinit(world.allocator);
+            }
+            for (s.singles) |*single_cache| {
+                single_cache.deinit(world.allocator);
+            }
+            world.allocator.destroy(s);
+        }
+    };
+
+    return System{
         .name = name,
-        .invoke = wrapper,
+        .invoke = try createSystemInvokeFunction(system),
+        .deinit = X.deinit,
+        .state = state,
         .enabled = true,
-    });
+        .query_counters = &state.query_counters,
+    };
+}
+
+/// Registers the observers of all `Added`/`Removed` parameters, so events are recorded before the system runs the first time.
+fn observeSystemParameters(self: *Self, comptime system: anytype, observers: []usize) !void {
+    const ArgsType = std.meta.ArgsTuple(@TypeOf(system));
+    inline for (@typeInfo(ArgsType).Struct.fields) |field, i| {
+        const ParamType = field.field_type;
+        if (@typeInfo(ParamType) == .Struct) {
+            if (@hasDecl(ParamType, "Type")) {
+                if (ParamType.Type == .Observer) {
+                    observers[i] = try self.observe(ParamType.Kind, Rtti.typeId(ParamType.ComponentType));
+                }
+            }
+        }
+    }
 }
 
 fn createSystemInvokeFunction(comptime system: anytype) !System.InvokeFunction {
     const X = struct {
-        fn invoke(world: *Self) !void {
+        fn invoke(world: *Self, state_ptr: *anyopaque) !bool {
             const ArgsType = std.meta.ArgsTuple(@TypeOf(system));
             const argsTypeInfo = @typeInfo(ArgsType).Struct;
+            const State = SystemState(system);
+            const state = @ptrCast(*State, @alignCast(@alignOf(State), state_ptr));
+
+            if (!try shouldRun(world, state)) {
+                for (state.query_counters) |*query_counters| {
+                    query_counters.entities = 0;
+                    query_counters.chunks = 0;
+                }
+                return false;
+            }
 
             var args: ArgsType = undefined;
 
-            inline for (argsTypeInfo.fields) |field| {
+            inline for (argsTypeInfo.fields) |field, i| {
                 const ParamType = field.field_type;
                 const paramTypeInfo = @typeInfo(ParamType);
 
@@ -275,7 +728,13 @@ fn createSystemInvokeFunction(comptime system: anytype) !System.InvokeFunction {
                     if (@hasDecl(ParamType, "Type")) {
                         const systemParamType: SystemParameterType = ParamType.Type;
                         switch (systemParamType) {
-                            .Query => try handleQuery(world, argPtr, ParamType),
+                            .Query => try handleQuery(world, argPtr, ParamType, &state.queries[i], &state.query_counters[i]),
+                            .Observer => argPtr.* = .{ .entities = try world.getObservedEntities(ParamType.Kind, Rtti.typeId(ParamType.ComponentType), state.observers[i]) },
+                            .Single => try handleSingle(world, argPtr, ParamType, &state.singles[i]),
+                            .Sliced => {
+                                try handleQuery(world, &argPtr.query, @TypeOf(argPtr.query), &state.queries[i], &state.query_counters[i]);
+                                argPtr.cursor = &state.slice_cursors[i];
+                            },
                         }
                     }
                 } else if (paramTypeInfo == .Pointer) {
@@ -284,14 +743,14 @@ fn createSystemInvokeFunction(comptime system: anytype) !System.InvokeFunction {
                         argPtr.* = world;
                     } else {
                         // Parameter is a resource.
-                        try handleResource(world, argPtr, ParamType);
+                        try handleResource(world, argPtr, ParamType, &state.resources[i]);
                     }
                 }
             }
 
             try @call(.{}, system, args);
 
-            inline for (argsTypeInfo.fields) |field| {
+            inline for (argsTypeInfo.fields) |field, i| {
                 const ParamType = field.field_type;
                 const paramTypeInfo = @typeInfo(ParamType);
 
@@ -302,18 +761,71 @@ fn createSystemInvokeFunction(comptime system: anytype) !System.InvokeFunction {
                     if (@hasDecl(ParamType, "Type")) {
                         const systemParamType: SystemParameterType = ParamType.Type;
                         switch (systemParamType) {
-                            .Query => argPtr.deinit(),
+                            .Query, .Sliced => argPtr.deinit(),
+                            // Only consumed once the system actually ran, skipped systems get the events in their next run.
+                            .Observer => try world.consumeObservedEntities(ParamType.Kind, Rtti.typeId(ParamType.ComponentType), state.observers[i]),
+                            .Single => {},
                         }
                     }
                 }
             }
+
+            return true;
+        }
+
+        /// Only collects the matching tables of query parameters, chunk lists are built after the system is known to run.
+        fn shouldRun(world: *Self, state: *SystemState(system)) !bool {
+            const criteria = state.criteria;
+
+            var tables_version: ?u64 = null;
+            if (criteria.skip_if_queries_empty or criteria.skip_if_tables_unchanged) {
+                var has_queries = false;
+                var entities: u64 = 0;
+                var version: u64 = world.tables_version;
+
+                inline for (@typeInfo(std.meta.ArgsTuple(@TypeOf(system))).Struct.fields) |field, i| {
+                    const ParamType = field.field_type;
+                    if (@typeInfo(ParamType) == .Struct and @hasDecl(ParamType, "Type") and (ParamType.Type == .Query or ParamType.Type == .Sliced)) {
+                        has_queries = true;
+                        try updateQueryTables(world, ParamType, &state.queries[i]);
+                        for (state.queries[i].tables.items) |table| {
+                            entities += table.getEnabledEntityCount();
+                            version +%= table.version;
+                        }
+                    }
+                }
+
+                if (criteria.skip_if_queries_empty and has_queries and entities == 0) {
+                    return false;
+                }
+                if (criteria.skip_if_tables_unchanged) {
+                    if (state.last_tables_version != null and state.last_tables_version.? == version) {
+                        return false;
+                    }
+                    tables_version = version;
+                }
+            }
+
+            var resource_version: ?u64 = null;
+            if (criteria.resource_changed) |index| {
+                const version = world.getResourceVersion(index);
+                if (state.last_resource_version != null and state.last_resource_version.? == version) {
+                    return false;
+                }
+                resource_version = version;
+            }
+
+            // Only remember the versions of runs which actually happen.
+            if (tables_version != null) state.last_tables_version = tables_version;
+            if (resource_version != null) state.last_resource_version = resource_version;
+            return true;
         }
     };
 
     return X.invoke;
 }
 
-fn handleResource(world: *Self, queryArg: anytype, comptime ParamType: type) !void {
+fn handleResource(world: *Self, queryArg: anytype, comptime ParamType: type, cached: *?*u8) !void {
     const paramTypeInfo = @typeInfo(ParamType);
     if (paramTypeInfo != .Pointer or paramTypeInfo.Pointer.size != .One) {
         @compileError("handleResource: ParamType must be a pointer to a single item, but is " ++ @typeName(ParamType));
@@ -321,60 +833,104 @@ fn handleResource(world: *Self, queryArg: anytype, comptime ParamType: type) !vo
 
     const ResourceType = paramTypeInfo.Pointer.child;
 
-    const resource = try world.getResource(ResourceType);
-    queryArg.* = @ptrCast(ParamType, resource);
+    if (cached.* == null) {
+        cached.* = @ptrCast(*u8, try world.getResource(ResourceType));
+    }
+    queryArg.* = @ptrCast(ParamType, @alignCast(@alignOf(ResourceType), cached.*.?));
+}
+
+fn updateQueryTables(world: *Self, comptime ParamType: type, cache: *QueryCache) !void {
+    if (cache.tables_version == null or cache.tables_version.? != world.tables_version) {
+        const archetype = try world.createArchetypeStruct(ParamType.ComponentTypes);
+        try world.getTablesForQuery(archetype, &cache.tables);
+        // Collecting the tables can create the table for the query itself, so the version is read afterwards.
+        cache.tables_version = world.tables_version;
+    }
 }
 
-fn handleQuery(world: *Self, queryArg: anytype, comptime ParamType: type) !void {
-    const ComponentTypes = ParamType.ComponentTypes;
+fn handleQuery(world: *Self, queryArg: anytype, comptime ParamType: type, cache: *QueryCache, counters: *Stats.QueryCounters) !void {
+    try updateQueryTables(world, ParamType, cache);
 
-    const archetype = try world.createArchetypeStruct(ComponentTypes);
+    cache.chunks.clearRetainingCapacity();
+    for (cache.tables.items) |table| {
+        try appendChunks(world.allocator, &cache.chunks, table);
+    }
+    queryArg.* = ParamType.init(world.allocator, world, cache.tables.items, cache.chunks.items, false);
 
-    var tables = try world.getDirectSupersetTables(archetype);
-    defer tables.deinit();
-    var chunks = std.ArrayList(*Chunk).init(world.allocator);
-    for (tables.items) |table| {
-        var chunk = table.firstChunk;
-        while (true) {
-            if (chunk.count > 0) {
-                try chunks.append(chunk);
-            }
-            if (chunk.next) |next| {
-                chunk = next;
-            } else {
-                break;
+    counters.entities = queryArg.count();
+    counters.chunks = cache.chunks.items.len;
+}
+
+fn handleSingle(world: *Self, singleArg: anytype, comptime ParamType: type, cache: *SingleCache) !void {
+    if (cache.tables_version == null or cache.tables_version.? != world.tables_version) {
+        const archetype = try world.createArchetypeStruct(ParamType.ComponentTypes);
+        try world.getTablesForQuery(archetype, &cache.tables);
+        cache.tables_version = world.tables_version;
+    }
+
+    var count: u64 = 0;
+    for (cache.tables.items) |table| {
+        count += table.getEnabledEntityCount();
+    }
+    if (count == 0) {
+        return error.SingleNotFound;
+    }
+    if (count > 1) {
+        return error.SingleNotUnique;
+    }
+
+    const cached_entity = cache.entity.get();
+    if (cached_entity == null or cached_entity.?.disabled or cached_entity.?.chunk.table != cache.table) {
+        // Exactly one enabled row in all tables, so it's the first enabled row of any chunk.
+        cache.entity = find: for (cache.tables.items) |table| {
+            var chunk: ?*Chunk = table.firstChunk;
+            while (chunk) |c| {
+                const row = c.nextEnabledRow(0);
+                if (row < c.count) {
+                    break :find c.entity_refs[row];
+                }
+                chunk = c.next;
             }
+        } else unreachable;
+        // Group storage rows point to the entity, whose chunk is in its archetype table.
+        cache.table = cache.entity.entity.chunk.table;
+    }
+
+    const entity = cache.entity.entity;
+    const table = cache.table.?;
+    var handle: ParamType.EntityHandle = undefined;
+    handle.ref = &cache.entity;
+
+    const typeInfo = @typeInfo(@TypeOf(ParamType.ComponentTypes)).Struct;
+    const handleTypeInfo = @typeInfo(ParamType.EntityHandle).Struct;
+    inline for (typeInfo.fields) |field, i| {
+        const ComponentType = @field(ParamType.ComponentTypes, field.name);
+        if (@sizeOf(ComponentType) > 0) {
+            const component_id = world.findComponentId(Rtti.typeId(ComponentType)) orelse unreachable;
+            const data = table.getComponentRaw(entity, component_id) orelse unreachable;
+            @field(handle, handleTypeInfo.fields[i + 1].name) = @ptrCast(*ComponentType, @alignCast(@alignOf(ComponentType), data.ptr));
         }
     }
-    queryArg.* = ParamType.init(chunks.allocator, world, chunks.items, true);
+
+    singleArg.* = .{ .entity = handle };
 }
 
 const AllEntitiesQuery = Query(.{});
 
 pub fn entities(self: *Self) !AllEntitiesQuery.Iterator {
-    var chunks = std.ArrayList(*Chunk).init(self.allocator);
+    var chunks = std.ArrayListUnmanaged(*Chunk){};
+    errdefer chunks.deinit(self.allocator);
     for (self.archetypeTablesArray.items) |table| {
-        var chunk = table.firstChunk;
-        while (true) {
-            if (chunk.count > 0) {
-                try chunks.append(chunk);
-            }
-            if (chunk.next) |next| {
-                chunk = next;
-            } else {
-                break;
-            }
-        }
+        try appendChunks(self.allocator, &chunks, table);
     }
-    return AllEntitiesQuery.init(chunks.allocator, self, chunks.items, false).iterOwned();
+    // Copied like in `query`, creating a table while iterating would reallocate `archetypeTablesArray`.
+    const tables = try self.allocator.dupe(*ArchetypeTable, self.archetypeTablesArray.items);
+    errdefer self.allocator.free(tables);
+    return AllEntitiesQuery.init(self.allocator, self, tables, chunks.toOwnedSlice(self.allocator), false).iterOwned();
 }
 
 pub fn getEntityCount(self: *Self) usize {
-    var result: usize = 0;
-    for (self.archetypeTablesArray.items) |table| {
-        result += table.getEntityCount();
-    }
-    return result;
+    return self.entity_count;
 }
 
 pub fn reserveEntityId(self: *Self) EntityId {
@@ -387,7 +943,7 @@ pub fn reserveEntity(self: *Self, id: EntityId) !EntityRef {
     var entity = if (self.entityPool.items.len > 0) self.entityPool.pop() else try self.entityArena.allocator().create(Entity);
     // Set id to zero because the entity doesn't actually exist at this point in any archetype table,
     // but entity.chunk is not nullable so we can't just set this to null.
-    entity.id = 0;
+    entity.* = .{ .id = 0 };
     return EntityRef{ .id = id, .entity = entity };
 }
 
@@ -406,14 +962,15 @@ pub fn isEntityAlive(self: *Self, entityId: EntityId) bool {
 }
 
 pub fn createEntityFromReserved(self: *Self, entity_ref: EntityRef) !void {
-    self.version += 1;
+    self.counters.recordStructuralChange();
 
     entity_ref.entity.id = entity_ref.id;
     try self.baseArchetypeTable.addEntity(entity_ref.entity, .{});
+    self.entity_count += 1;
 }
 
 pub fn createEntityBundleFromReserved(self: *Self, entity_ref: EntityRef, components: anytype) !void {
-    self.version += 1;
+    self.counters.recordStructuralChange();
 
     const ComponentsType = if (@typeInfo(@TypeOf(components)) == .Pointer) std.meta.Child(@TypeOf(components)) else @TypeOf(components);
 
@@ -422,16 +979,20 @@ pub fn createEntityBundleFromReserved(self: *Self, entity_ref: EntityRef, compon
     const archetype = try self.createArchetypeStructType(ComponentsType);
     var table = try self.getOrCreateArchetypeTable(archetype);
     try table.addEntity(entity_ref.entity, components);
+    self.entity_count += 1;
+    try self.added_observers.record(table.archetype.components, entity_ref);
 }
 
 pub fn createEntityBundleFromReservedRaw(self: *Self, entity_ref: EntityRef, component_types: []const Rtti.TypeId, component_data: []const []const u8) !void {
-    self.version += 1;
+    self.counters.recordStructuralChange();
 
     entity_ref.entity.id = entity_ref.id;
 
     const archetype = try self.createArchetypeFromTypes(component_types);
     var table = try self.getOrCreateArchetypeTable(archetype);
     try table.addEntityRaw(entity_ref.entity, component_types, component_data);
+    self.entity_count += 1;
+    try self.added_observers.record(table.archetype.components, entity_ref);
 }
 
 pub fn createEntityWithId(self: *Self, id: EntityId) !EntityRef {
@@ -455,9 +1016,11 @@ pub fn createEntityBundle(self: *Self, components: anytype) !EntityRef {
 }
 
 pub fn deleteEntity(self: *Self, entity_ref: EntityRef) !void {
-    self.version += 1;
     if (entity_ref.get()) |entity| {
-        entity.chunk.removeEntity(entity.index);
+        self.counters.recordStructuralChange();
+        try self.removed_observers.record(entity.chunk.table.archetype.components, entity_ref);
+        entity.chunk.table.removeEntity(entity, null);
+        self.entity_count -= 1;
         entity.* = .{};
         try self.entityPool.append(entity);
     } else {
@@ -465,8 +1028,30 @@ pub fn deleteEntity(self: *Self, entity_ref: EntityRef) !void {
     }
 }
 
+/// Disabled entities keep their row and components but are skipped by queries until they are enabled again.
+/// Doesn't move the entity between tables, so parking and reusing entities is O(1).
+pub fn setEntityEnabled(self: *Self, entity_ref: EntityRef, enabled: bool) !void {
+    if (entity_ref.get()) |entity| {
+        entity.disabled = !enabled;
+        entity.chunk.setRowEnabled(entity.index, enabled);
+        if (entity.chunk.table.group != null) {
+            entity.group_chunk.setRowEnabled(entity.group_index, enabled);
+        }
+    } else {
+        return error.InvalidEntity;
+    }
+}
+
+pub fn isEntityEnabled(self: *Self, entity_ref: EntityRef) !bool {
+    _ = self;
+    if (entity_ref.get()) |entity| {
+        return !entity.disabled;
+    } else {
+        return error.InvalidEntity;
+    }
+}
+
 pub fn addComponent(self: *Self, entity_ref: EntityRef, component: anytype) !void {
-    self.version += 1;
     const componentType = Rtti.typeId(@TypeOf(component));
     try self.addComponentRaw(entity_ref, componentType, std.mem.asBytes(&component));
 }
@@ -479,46 +1064,135 @@ pub fn getComponentIdSet(self: *Self, componentType: Rtti.TypeId) !BitSet {
 }
 
 pub fn addComponentRaw(self: *Self, entity_ref: EntityRef, componentType: Rtti.TypeId, componentData: []const u8) !void {
-    self.version += 1;
-
     if (entity_ref.get()) |entity| {
         const newComponents = try self.getComponentIdSet(componentType);
-        var newArchetype = entity.chunk.table.archetype.addComponents(componentType.typeInfo.hash, newComponents);
+        var newArchetype = entity.chunk.table.archetype.addComponents(newComponents);
 
         var newTable: *ArchetypeTable = try self.getOrCreateArchetypeTable(newArchetype);
 
         const old_entity = entity.*;
+        self.recordMove(old_entity.chunk.table, newTable);
 
         // copy existing entity to new table
         try newTable.copyEntityWithComponentIntoRaw(entity, componentType, componentData);
 
         // Remove old entity
-        old_entity.chunk.removeEntity(old_entity.index);
+        old_entity.chunk.table.removeEntity(&old_entity, newTable);
+
+        try self.added_observers.record(newTable.archetype.components.without(old_entity.chunk.table.archetype.components), entity_ref);
     } else {
         return error.InvalidEntity;
     }
 }
 
 pub fn removeComponent(self: *Self, entity_ref: EntityRef, componentType: Rtti.TypeId) !void {
-    self.version += 1;
     if (entity_ref.get()) |entity| {
         const componentIds = try self.getComponentIdSet(componentType);
-        var newArchetype = entity.chunk.table.archetype.removeComponents(componentType.typeInfo.hash, componentIds);
+        var newArchetype = entity.chunk.table.archetype.removeComponents(componentIds);
 
         var newTable: *ArchetypeTable = try self.getOrCreateArchetypeTable(newArchetype);
 
         const old_entity = entity.*;
+        self.recordMove(old_entity.chunk.table, newTable);
 
         // copy existing entity to new table
         try newTable.copyEntityIntoRaw(entity);
 
         // Remove old entity
-        old_entity.chunk.removeEntity(old_entity.index);
+        old_entity.chunk.table.removeEntity(&old_entity, newTable);
+
+        try self.removed_observers.record(old_entity.chunk.table.archetype.components.without(newTable.archetype.components), entity_ref);
     } else {
         return error.InvalidEntity;
     }
 }
 
+fn recordMove(self: *Self, from: *ArchetypeTable, to: *ArchetypeTable) void {
+    self.counters.recordStructuralChange();
+    from.counters.frame_moves_out += 1;
+    to.counters.frame_moves_in += 1;
+}
+
+/// Adds `component` to every entity which has all `Components` and doesn't have the component yet.
+/// Tables are moved as a whole by copying column ranges (see `ArchetypeTable.moveAllRowsInto`),
+/// only tables which would change their group move their entities one by one.
+pub fn addComponentToAll(self: *Self, comptime Components: anytype, component: anytype) !void {
+    const component_type = Rtti.typeId(@TypeOf(component));
+    const component_id = try self.getComponentIdForRtti(component_type);
+    const component_set = try self.getComponentIdSet(component_type);
+
+    var tables = try self.getDirectSupersetTables(try self.createArchetypeStruct(Components));
+    defer tables.deinit();
+
+    for (tables.items) |table| {
+        if (table.getEntityCount() == 0 or table.archetype.components.isSet(component_id)) {
+            continue;
+        }
+
+        const new_table = try self.getOrCreateArchetypeTable(table.archetype.addComponents(component_set));
+        try self.moveAllEntities(table, new_table, component_set, .Added, component_type, std.mem.asBytes(&component));
+    }
+}
+
+/// Removes the component from every entity which has all `Components` and the component.
+/// See `addComponentToAll`.
+pub fn removeComponentFromAll(self: *Self, comptime Components: anytype, component_type: Rtti.TypeId) !void {
+    const component_set = try self.getComponentIdSet(component_type);
+
+    var archetype = try self.createArchetypeStruct(Components);
+    archetype = archetype.addComponents(component_set);
+    var tables = try self.getDirectSupersetTables(archetype);
+    defer tables.deinit();
+
+    for (tables.items) |table| {
+        if (table.getEntityCount() == 0) {
+            continue;
+        }
+
+        const new_table = try self.getOrCreateArchetypeTable(table.archetype.removeComponents(component_set));
+        try self.moveAllEntities(table, new_table, component_set, .Removed, component_type, &.{});
+    }
+}
+
+/// Moves all entities of `from` to `to`, which differ by the components in `changed`.
+/// `data` is the value of the added component, if any.
+fn moveAllEntities(self: *Self, from: *ArchetypeTable, to: *ArchetypeTable, changed: BitSet, kind: ObserverKind, component_type: Rtti.TypeId, data: []const u8) !void {
+    const count = from.getEntityCount();
+
+    var chunk: ?*Chunk = from.firstChunk;
+    while (chunk) |c| : (chunk = c.next) {
+        switch (kind) {
+            .Added => try self.added_observers.recordAll(changed, c.entity_refs[0..c.count]),
+            .Removed => try self.removed_observers.recordAll(changed, c.entity_refs[0..c.count]),
+        }
+    }
+
+    self.counters.recordStructuralChanges(count);
+    from.counters.frame_moves_out += count;
+    to.counters.frame_moves_in += count;
+
+    if (from.group == to.group) {
+        const component_id = if (kind == .Added and component_type.typeInfo.size > 0) self.findComponentId(component_type) else null;
+        try from.moveAllRowsInto(to, component_id, data);
+        return;
+    }
+
+    // Entering or leaving a group needs group rows added or removed per entity.
+    while (from.getEntityCount() > 0) {
+        var first: *Chunk = from.firstChunk;
+        while (first.count == 0) {
+            first = first.next.?;
+        }
+        const entity = first.entity_refs[first.count - 1].entity;
+        const old_entity = entity.*;
+        switch (kind) {
+            .Added => try to.copyEntityWithComponentIntoRaw(entity, component_type, data),
+            .Removed => try to.copyEntityIntoRaw(entity),
+        }
+        from.removeEntity(&old_entity, to);
+    }
+}
+
 pub fn getComponentType(self: *const Self, componentId: ComponentId) ?Rtti.TypeId {
     if (componentId >= self.componentIdToComponentType.items.len) {
         return null;
@@ -535,8 +1209,7 @@ pub fn getComponent(self: *Self, entity_ref: EntityRef, comptime ComponentType:
         }
 
         // Component exists on this entity.
-        const componentIndex = entity.chunk.table.getListIndexForType(Rtti.typeId(ComponentType)) orelse unreachable;
-        const rawData = entity.chunk.getComponentRaw(componentIndex, entity.index);
+        const rawData = entity.chunk.table.getComponentRaw(entity, componentId) orelse unreachable;
         std.debug.assert(rawData.len == @sizeOf(ComponentType));
         return @ptrCast(*ComponentType, @alignCast(@alignOf(ComponentType), rawData.ptr));
     } else {
@@ -561,85 +1234,107 @@ pub fn getComponentId(self: *Self, comptime ComponentType: type) !ComponentId {
     return self.getComponentIdForRtti(Rtti.typeId(ComponentType));
 }
 
+const no_component_id = std.math.maxInt(ComponentId);
+
+/// Returns the id of the component with the given type, or null if the component was never used in this world.
+pub inline fn findComponentId(self: *const Self, rtti: Rtti.TypeId) ?ComponentId {
+    const index = rtti.typeInfo.index;
+    if (index >= self.typeIndexToComponentId.items.len) {
+        return null;
+    }
+    const componentId = self.typeIndexToComponentId.items[index];
+    return if (componentId == no_component_id) null else componentId;
+}
+
 /// Returns the id of the component with the given type.
 pub fn getComponentIdForRtti(self: *Self, rtti: Rtti.TypeId) !ComponentId {
-    if (self.components.get(rtti)) |componentInfo| {
-        return componentInfo.id;
-    } else {
-        const componentId = self.componentIdToComponentType.items.len;
-        try self.components.put(rtti, .{ .id = componentId });
-        try self.componentIdToComponentType.append(rtti);
+    if (self.findComponentId(rtti)) |componentId| {
         return componentId;
     }
+
+    const componentId = self.componentIdToComponentType.items.len;
+    if (componentId >= BitSet.capacity) {
+        return error.TooManyComponentTypes;
+    }
+
+    const index = rtti.typeInfo.index;
+    if (index >= self.typeIndexToComponentId.items.len) {
+        try self.typeIndexToComponentId.appendNTimes(no_component_id, index + 1 - self.typeIndexToComponentId.items.len);
+    }
+    try self.componentIdToComponentType.append(rtti);
+    self.typeIndexToComponentId.items[index] = componentId;
+    return componentId;
 }
 
 /// Creates an archetype based on the given components.
 fn createArchetypeStruct(self: *Self, comptime Components: anytype) !Archetype {
-    var hash: u64 = 0;
     var bitSet = BitSet.initEmpty();
 
     const typeInfo = @typeInfo(@TypeOf(Components)).Struct;
     inline for (typeInfo.fields) |field| {
         const ComponentType = @field(Components, field.name);
         std.debug.assert(@TypeOf(ComponentType) == type);
-        const rtti = Rtti.typeId(ComponentType);
         bitSet.set(try self.getComponentId(ComponentType));
-        hash ^= rtti.typeInfo.hash;
     }
-    return Archetype.init(self, hash, bitSet);
+    return Archetype.init(self, bitSet);
 }
 
 fn createArchetypeStructType(self: *Self, comptime T: type) !Archetype {
-    var hash: u64 = 0;
     var bitSet = BitSet.initEmpty();
 
     const typeInfo = @typeInfo(T).Struct;
     inline for (typeInfo.fields) |field| {
         const ComponentType = field.field_type;
         std.debug.assert(@TypeOf(ComponentType) == type);
-        const rtti = Rtti.typeId(ComponentType);
         bitSet.set(try self.getComponentId(ComponentType));
-        hash ^= rtti.typeInfo.hash;
     }
-    return Archetype.init(self, hash, bitSet);
+    return Archetype.init(self, bitSet);
 }
 
 fn createArchetypeFromTypes(self: *Self, component_types: []const Rtti.TypeId) !Archetype {
-    var hash: u64 = 0;
     var bitSet = BitSet.initEmpty();
 
     for (component_types) |component_type| {
         bitSet.set(try self.getComponentIdForRtti(component_type));
-        hash ^= component_type.typeInfo.hash;
     }
-    return Archetype.init(self, hash, bitSet);
+    return Archetype.init(self, bitSet);
 }
 
 /// Creates an archetype table for the given archetype.
 fn createArchetypeTable(self: *Self, archetype: Archetype) !*ArchetypeTable {
     var table = try self.globalPool.allocator().create(ArchetypeTable);
-    try table.init(archetype, self.allocator);
+    try table.init(archetype, self.getOwningGroupOfTable(archetype.components), self.allocator, self.chunkAllocator.allocator());
 
-    var tableIter = self.archetypeTables.valueIterator();
-    while (tableIter.next()) |otherTable| {
-        if (table.archetype.components.isSubSetOf(otherTable.*.archetype.components)) {
-            try table.subsets.put(otherTable.*.archetype.components.without(table.archetype.components), otherTable.*);
-            try otherTable.*.supersets.put(otherTable.*.archetype.components.without(table.archetype.components), table);
+    for (self.archetypeTablesArray.items) |otherTable| {
+        if (table.archetype.components.isSubSetOf(otherTable.archetype.components)) {
+            try table.subsets.put(otherTable.archetype.components.without(table.archetype.components), otherTable);
+            try otherTable.supersets.put(otherTable.archetype.components.without(table.archetype.components), table);
         }
-        if (table.archetype.components.isSuperSetOf(otherTable.*.archetype.components)) {
-            try table.supersets.put(table.archetype.components.without(otherTable.*.archetype.components), otherTable.*);
-            try otherTable.*.subsets.put(table.archetype.components.without(otherTable.*.archetype.components), table);
+        if (table.archetype.components.isSuperSetOf(otherTable.archetype.components)) {
+            try table.supersets.put(table.archetype.components.without(otherTable.archetype.components), otherTable);
+            try otherTable.subsets.put(table.archetype.components.without(otherTable.archetype.components), table);
         }
     }
 
-    try self.archetypeTables.put(table, table);
+    try self.archetypeTables.put(table);
     try self.archetypeTablesArray.append(table);
+    self.tables_version += 1;
     return table;
 }
 
+/// Returns the first group whose components are all contained in a table with the given components.
+fn getOwningGroupOfTable(self: *Self, components: BitSet) ?*Group {
+    for (self.groups.items) |group| {
+        if (components.isSuperSetOf(group.components)) {
+            return group;
+        }
+    }
+    return null;
+}
+
 /// Returns the archetype table associated with the given archetype. Creates a new table if it doesn't exist yet.
 fn getOrCreateArchetypeTable(self: *Self, archetype: Archetype) !*ArchetypeTable {
-    if (self.archetypeTables.getKeyAdapted(&archetype, Archetype.HashTableContext{})) |table| {
+    if (self.archetypeTables.getArchetype(&archetype)) |table| {
         return table;
     } else {
         return try self.createArchetypeTable(try archetype.clone());
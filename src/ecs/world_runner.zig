@@ -0,0 +1,132 @@
+//! Steps several independent worlds in parallel on a fixed set of worker threads.
+//! Worlds don't share any mutable state, so every worker just takes the next world which wasn't stepped yet.
+//! Resources shared between worlds, e.g. an asset database, must only be read by systems.
+
+const std = @import("std");
+
+const Commands = @import("commands.zig");
+const World = @import("world.zig");
+
+const Self = @This();
+
+allocator: std.mem.Allocator,
+worlds: []const *World,
+threads: []std.Thread,
+
+mutex: std.Thread.Mutex = .{},
+start_condition: std.Thread.Condition = .{},
+done_condition: std.Thread.Condition = .{},
+
+/// Incremented for every step, workers wait until it changes.
+generation: u64 = 0,
+/// Workers which didn't finish the current step yet.
+running: usize = 0,
+quit: bool = false,
+
+next_world: std.atomic.Atomic(usize) = std.atomic.Atomic(usize).init(0),
+first_error: ?anyerror = null,
+
+/// `worlds` has to stay alive until `deinit`.
+pub fn init(allocator: std.mem.Allocator, worlds: []const *World, thread_count: usize) !*Self {
+    var self = try allocator.create(Self);
+    errdefer allocator.destroy(self);
+
+    self.* = Self{
+        .allocator = allocator,
+        .worlds = worlds,
+        .threads = try allocator.alloc(std.Thread, std.math.max(thread_count, 1)),
+    };
+    errdefer allocator.free(self.threads);
+
+    for (self.threads) |*thread, i| {
+        thread.* = std.Thread.spawn(.{}, workerMain, .{self}) catch |err| {
+            self.stopThreads(self.threads[0..i]);
+            return err;
+        };
+    }
+
+    return self;
+}
+
+pub fn deinit(self: *Self) void {
+    self.stopThreads(self.threads);
+    self.allocator.free(self.threads);
+    self.allocator.destroy(self);
+}
+
+fn stopThreads(self: *Self, threads: []std.Thread) void {
+    self.mutex.lock();
+    self.quit = true;
+    self.start_condition.broadcast();
+    self.mutex.unlock();
+
+    for (threads) |thread| {
+        thread.join();
+    }
+}
+
+/// Runs the frame systems of every world, applies their `Commands` resource and ends their frame.
+/// Blocks until all worlds are done. Returns the first error of any world, the other worlds are still stepped.
+pub fn step(self: *Self) !void {
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    self.next_world.store(0, .Monotonic);
+    self.first_error = null;
+    self.running = self.threads.len;
+    self.generation += 1;
+    self.start_condition.broadcast();
+
+    while (self.running > 0) {
+        self.done_condition.wait(&self.mutex);
+    }
+
+    if (self.first_error) |err| {
+        return err;
+    }
+}
+
+fn stepWorld(world: *World) !void {
+    try world.runFrameSystems();
+    if (world.getResource(Commands)) |commands| {
+        try commands.applyCommands();
+    } else |_| {}
+    world.endFrame();
+}
+
+fn workerMain(self: *Self) void {
+    var generation: u64 = 0;
+    while (true) {
+        self.mutex.lock();
+        while (self.generation == generation and !self.quit) {
+            self.start_condition.wait(&self.mutex);
+        }
+        if (self.quit) {
+            self.mutex.unlock();
+            return;
+        }
+        generation = self.generation;
+        self.mutex.unlock();
+
+        while (true) {
+            const index = self.next_world.fetchAdd(1, .Monotonic);
+            if (index >= self.worlds.len)
+                break;
+
+            stepWorld(self.worlds[index]) catch |err| {
+                self.mutex.lock();
+                defer self.mutex.unlock();
+                if (self.first_error == null) {
+                    self.first_error = err;
+                }
+            };
+        }
+
+        self.mutex.lock();
+        self.running -= 1;
+        if (self.running == 0) {
+            self.done_condition.signal();
+        }
+        self.mutex.unlock();
+    }
+}
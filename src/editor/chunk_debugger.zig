@@ -14,9 +14,17 @@ const Vec2 = imgui.Vec2;
 
 const Self = @This();
 
+const stats_file_path = "zentt_stats.jsonl";
+const StatsWriter = std.io.BufferedWriter(16 * 1024, std.fs.File.Writer);
+
 allocator: std.mem.Allocator,
 arena: std.heap.ArenaAllocator,
 
+/// When set, a line of JSON with the world stats is written every frame.
+stats_file: ?std.fs.File = null,
+/// Collects the line of a frame so it is written to `stats_file` at once.
+stats_writer: StatsWriter = undefined,
+
 pub fn init(allocator: std.mem.Allocator) Self {
     return Self{
         .allocator = allocator,
@@ -25,9 +33,20 @@ pub fn init(allocator: std.mem.Allocator) Self {
 }
 
 pub fn deinit(self: *Self) void {
+    self.closeStatsFile();
     self.arena.deinit();
 }
 
+fn closeStatsFile(self: *Self) void {
+    if (self.stats_file) |file| {
+        self.stats_writer.flush() catch |err| {
+            std.log.err("Failed to write {s}: {}", .{ stats_file_path, err });
+        };
+        file.close();
+        self.stats_file = null;
+    }
+}
+
 fn resetTextBuffer(self: *Self) void {
     self.arena.deinit();
     self.arena = std.heap.ArenaAllocator.init(self.allocator);
@@ -41,38 +60,45 @@ fn format(self: *Self, comptime fmt: []const u8, args: anytype) ![:0]const u8 {
 
 pub fn draw(self: *Self, world: *World) !void {
     self.resetTextBuffer();
+
+    var stats = try world.stats(self.arena.allocator());
+    stats.sortByRows();
+
+    if (self.stats_file != null) {
+        try stats.writeJson(self.stats_writer.writer());
+        try self.stats_writer.flush();
+    }
+
     const open = imgui.Begin("Chunks");
     defer imgui.End();
     if (!open)
         return;
 
-    const ArchetypeTableData = struct {
-        table: *ArchetypeTable,
-        entityCount: usize,
-
-        pub fn compare(context: void, lhs: @This(), rhs: @This()) bool {
-            _ = context;
-            return lhs.entityCount > rhs.entityCount;
+    var record = self.stats_file != null;
+    if (imgui.Checkbox("Record stats to " ++ stats_file_path, &record)) {
+        if (record) {
+            const file = try std.fs.cwd().createFile(stats_file_path, .{});
+            self.stats_file = file;
+            self.stats_writer = std.io.bufferedWriter(file.writer());
+        } else {
+            self.closeStatsFile();
         }
-    };
-
-    var tables = try std.ArrayList(ArchetypeTableData).initCapacity(self.allocator, world.archetypeTables.count());
-    defer tables.deinit();
-    var iter = world.archetypeTables.valueIterator();
-    while (iter.next()) |table| {
-        try tables.append(.{ .table = table.*, .entityCount = table.*.getEntityCount() });
     }
 
-    std.sort.sort(ArchetypeTableData, tables.items, {}, ArchetypeTableData.compare);
+    imgui.Text("Entities: %llu", stats.entities);
+    imgui.Text("Memory: %.2f / %.2f MiB", toMiB(stats.bytes_used), toMiB(stats.bytes_reserved));
+    imgui.Text("Structural changes: %llu (last frame %llu)", stats.structural_changes, stats.last_frame_structural_changes);
+    imgui.Text("Commands: %llu (last frame %llu)", stats.commands_applied, stats.last_frame_commands_applied);
+    imgui.Separator();
 
-    for (tables.items) |table| {
+    for (stats.tables) |*table| {
         imgui.PushIDPtr(table.table);
         defer imgui.PopID();
 
-        const name = try self.format("{}", .{table.table.archetype});
+        const name = try self.format("{}{s}", .{ table.table.archetype, if (table.table.is_group_storage) " (group storage)" else "" });
         const collapsingHeaderOpen = imgui.CollapsingHeaderBoolPtrExt(name.ptr, null, imgui.TreeNodeFlags.CollapsingHeader.with(.{ .DefaultOpen = true }));
 
-        const entitiesCountStr = try self.format("{}", .{table.entityCount});
+        const entitiesCountStr = try self.format("{}", .{table.rows});
         imgui.SameLineExt(imgui.GetWindowContentRegionWidth() - imgui.CalcTextSize(entitiesCountStr.ptr).x - 10, -1);
         imgui.Text("%s", entitiesCountStr.ptr);
 
@@ -90,7 +116,43 @@ pub fn draw(self: *Self, world: *World) !void {
                 imgui.Text("Entity Count");
 
                 _ = imgui.TableSetColumnIndex(1);
-                imgui.Text("%llu", table.entityCount);
+                imgui.Text("%llu", table.rows);
+
+                _ = imgui.TableSetColumnIndex(2);
+                imgui.Text("%llu", table.capacity);
+
+                // Memory
+                imgui.TableNextRow(.{}, 0);
+                _ = imgui.TableSetColumnIndex(0);
+                imgui.Text("Bytes used/reserved");
+
+                _ = imgui.TableSetColumnIndex(1);
+                imgui.Text("%llu / %llu", table.bytes_used, table.bytes_reserved);
+
+                _ = imgui.TableSetColumnIndex(2);
+                imgui.Text("%.1f%%", table.fill_ratio * 100);
+
+                // Moves
+                imgui.TableNextRow(.{}, 0);
+                _ = imgui.TableSetColumnIndex(0);
+                imgui.Text("Moves in/out (last frame)");
+
+                _ = imgui.TableSetColumnIndex(1);
+                imgui.Text("%llu / %llu", table.moves_in, table.moves_out);
+
+                // Components
+                for (table.components) |*component| {
+                    imgui.TableNextRow(.{}, 0);
+                    _ = imgui.TableSetColumnIndex(0);
+                    const component_name = try self.format("{}", .{component.component_type});
+                    imgui.Text("%s", component_name.ptr);
+
+                    _ = imgui.TableSetColumnIndex(1);
+                    imgui.Text("%llu", component.bytes_used);
+
+                    _ = imgui.TableSetColumnIndex(2);
+                    imgui.Text("%llu", component.bytes_reserved);
+                }
 
                 // Chunks
                 var nextChunk: ?*Chunk = table.table.firstChunk;
@@ -102,7 +164,6 @@ pub fn draw(self: *Self, world: *World) !void {
 
                     _ = imgui.TableSetColumnIndex(1);
                     imgui.Text("%llu", chunk.count);
-                    nextChunk = chunk.next;
 
                     _ = imgui.TableSetColumnIndex(2);
                     imgui.Text("%llu", chunk.capacity);
@@ -113,6 +174,10 @@ pub fn draw(self: *Self, world: *World) !void {
     }
 }
 
+fn toMiB(bytes: u64) f64 {
+    return @intToFloat(f64, bytes) / (1024 * 1024);
+}
+
 pub fn imguiDetails(self: *Self) void {
     _ = self;
 }
@@ -2,6 +2,7 @@ const std = @import("std");
 
 const Entity = @import("../ecs/entity.zig");
 const EntityRef = Entity.Ref;
+const Chunk = @import("../ecs/chunk.zig");
 const ComponentId = @import("../ecs/entity.zig").ComponentId;
 const World = @import("../ecs/world.zig");
 const Tag = @import("../ecs/tag_component.zig").Tag;
@@ -85,28 +86,10 @@ pub fn draw(self: *Self, world: *World, entity_ref: EntityRef, commands: *Comman
         }
 
         // Components with data
-        // chunk.components only includes non zero sized components.
-        for (entity.chunk.components) |components, i| {
-            imgui.PushIDInt(@intCast(i32, i));
-            defer imgui.PopID();
-
-            const rtti = components.componentType.typeInfo;
-            const component_name = try self.format("{s}", .{rtti.name});
-
-            const open = imgui.CollapsingHeaderBoolPtrExt(
-                component_name.ptr,
-                null,
-                imgui.TreeNodeFlags.CollapsingHeader.with(.{ .DefaultOpen = true, .AllowItemOverlap = true }),
-            );
-
-            imgui.SameLineExt(imgui.GetWindowContentRegionWidth() - imgui.CalcTextSize("X").x - 10, -1);
-            if (imgui.SmallButton("X")) {
-                _ = commands.getEntity(entity_ref).removeComponentRaw(components.componentType);
-            }
-
-            if (open) {
-                imgui2.anyDynamic(rtti, components.getRaw(entity.index));
-            }
+        // chunk.components only includes non zero sized components which are not owned by a group.
+        try self.drawComponents(entity.chunk.components, entity.index, 0, entity_ref, commands);
+        if (entity.chunk.table.group != null) {
+            try self.drawComponents(entity.group_chunk.components, entity.group_index, entity.chunk.components.len, entity_ref, commands);
         }
 
         // Buttons for adding components
@@ -136,6 +119,31 @@ pub fn draw(self: *Self, world: *World, entity_ref: EntityRef, commands: *Comman
     imgui.End();
 }
 
+fn drawComponents(self: *Self, component_lists: []Chunk.Components, index: u64, id_offset: usize, entity_ref: EntityRef, commands: *Commands) !void {
+    for (component_lists) |components, i| {
+        imgui.PushIDInt(@intCast(i32, id_offset + i));
+        defer imgui.PopID();
+
+        const rtti = components.componentType.typeInfo;
+        const component_name = try self.format("{s}", .{rtti.name});
+
+        const open = imgui.CollapsingHeaderBoolPtrExt(
+            component_name.ptr,
+            null,
+            imgui.TreeNodeFlags.CollapsingHeader.with(.{ .DefaultOpen = true, .AllowItemOverlap = true }),
+        );
+
+        imgui.SameLineExt(imgui.GetWindowContentRegionWidth() - imgui.CalcTextSize("X").x - 10, -1);
+        if (imgui.SmallButton("X")) {
+            _ = commands.getEntity(entity_ref).removeComponentRaw(components.componentType);
+        }
+
+        if (open) {
+            imgui2.anyDynamic(rtti, components.getRaw(index));
+        }
+    }
+}
+
 fn resetTextBuffer(self: *Self) void {
     self.arena.deinit();
     self.arena = std.heap.ArenaAllocator.init(self.allocator);
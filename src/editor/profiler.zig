@@ -3,10 +3,15 @@ const std = @import("std");
 const imgui = @import("imgui.zig");
 const imgui2 = @import("imgui2.zig");
 
+const World = @import("../ecs/world.zig");
+
 const Vec2 = imgui.Vec2;
 
 const Self = @This();
 
+const systems_file_path = "zentt_systems.jsonl";
+const SystemsWriter = std.io.BufferedWriter(16 * 1024, std.fs.File.Writer);
+
 fn Measurement(comptime T: type) type {
     return struct {
         index: usize = 0,
@@ -26,6 +31,11 @@ scale: f64 = 20,
 selected: ?[]const u8 = null,
 index: u64 = 0,
 
+/// When set, the counters of all systems are written as one line of JSON per frame in `recordSystems`.
+systems_file: ?std.fs.File = null,
+/// Collects the line of a frame so it is written to `systems_file` at once.
+systems_writer: SystemsWriter = undefined,
+
 pub fn init(allocator: std.mem.Allocator, init_global: bool) !*Self {
     var self = try allocator.create(Self);
 
@@ -55,6 +65,8 @@ pub fn deinit(self: *Self) void {
     }
     self.counts.deinit();
 
+    self.closeSystemsFile();
+
     self.allocator.destroy(self);
 }
 
@@ -104,6 +116,35 @@ pub fn recordTime(self: *Self, name: []const u8, value: f64, samples: u64) !void
     try self.recordIntoFifo(f64, &self.timings, name, value, samples);
 }
 
+/// Records the time of the last run of every system of the world, with the matched entities as samples,
+/// so the average per sample is the cost per entity. Call once per frame after all systems ran.
+pub fn recordSystems(self: *Self, world: *const World) !void {
+    for (world.stages) |*stage| {
+        for (stage.systems.items) |*system| {
+            if (!system.enabled) continue;
+            const name = std.mem.span(system.name);
+            const time_ms = @intToFloat(f64, system.counters.last_time_ns) / std.time.ns_per_ms;
+            try self.recordTime(name, time_ms, std.math.max(system.getLastEntityCount(), 1));
+            try self.recordCount(name, system.counters.last_commands, 1);
+        }
+    }
+
+    if (self.systems_file != null) {
+        try world.writeSystemsJson(self.systems_writer.writer());
+        try self.systems_writer.flush();
+    }
+}
+
+fn closeSystemsFile(self: *Self) void {
+    if (self.systems_file) |file| {
+        self.systems_writer.flush() catch |err| {
+            std.log.err("Failed to write {s}: {}", .{ systems_file_path, err });
+        };
+        file.close();
+        self.systems_file = null;
+    }
+}
+
 pub fn draw(self: *Self) !void {
     imgui.PushStyleVarVec2(.WindowPadding, Vec2{});
     defer imgui.PopStyleVar();
@@ -156,6 +197,24 @@ pub fn draw(self: *Self) !void {
                 if (self.scale > 1000) self.scale = 1000;
             }
 
+            { // System log
+                imgui.TableNextRow(.{}, 0);
+                _ = imgui.TableSetColumnIndex(0);
+                imgui.Text("Record systems to " ++ systems_file_path);
+
+                _ = imgui.TableSetColumnIndex(1);
+                var record = self.systems_file != null;
+                if (imgui.Checkbox("##record_systems", &record)) {
+                    if (record) {
+                        const file = try std.fs.cwd().createFile(systems_file_path, .{});
+                        self.systems_file = file;
+                        self.systems_writer = std.io.bufferedWriter(file.writer());
+                    } else {
+                        self.closeSystemsFile();
+                    }
+                }
+            }
+
             imgui.Separator();
 
             var iter = self.timings.iterator();
@@ -29,6 +29,7 @@ const game = @import("../game/game.zig");
 const TransformComponent = game.TransformComponent;
 const SpriteComponent = game.SpriteComponent;
 const AnimatedSpriteComponent = game.AnimatedSpriteComponent;
+const SceneMatricesUbo = @import("../rendering/sprite_renderer.zig").SceneMatricesUbo;
 
 const Self = @This();
 
@@ -36,6 +37,9 @@ world: *World,
 app: *App,
 content_size: imgui.Vec2 = .{},
 screen_matrix: Mat4 = Mat4.identity(),
+/// Camera of the frame which is rendered next, copied in `prepare`.
+/// The sprite renderer's own matrices are written by the render thread while systems use the viewport.
+matrices: SceneMatricesUbo = .{ .view = Mat4.identity(), .proj = Mat4.identity() },
 
 pub fn init(
     world: *World,
@@ -68,7 +72,12 @@ pub fn drawScene(self: *Self) !void {
     }
 }
 
+/// Has to be called before the frame and render systems run.
 pub fn prepare(self: *Self) void {
+    if (self.world.getResource(game.RenderExtraction)) |extraction| {
+        self.matrices = extraction.front().matrices;
+    } else |_| {}
+
     const open = imgui.Begin("Viewport");
     defer imgui.End();
 
@@ -120,8 +129,8 @@ pub fn draw(self: *Self, selected_entity: EntityRef) !?Vec2 {
                 const size = Vec2.new(texture_size.x(), texture_size.y()).scale(0.5 * transform.size);
 
                 // Transform positions into screen space
-                const view = self.app.sprite_renderer.matrices.view;
-                const proj = self.app.sprite_renderer.matrices.proj;
+                const view = self.matrices.view;
+                const proj = self.matrices.proj;
 
                 const p0_screen = self.world2ToViewport(position.xy().sub(size));
                 const p1_screen = self.world2ToViewport(position.xy().add(size));
@@ -211,8 +220,8 @@ pub fn world2ToViewport(self: *Self, position: Vec2) Vec2 {
 }
 
 pub fn world3ToViewport(self: *Self, position: Vec3) Vec2 {
-    const view = self.app.sprite_renderer.matrices.view;
-    const proj = self.app.sprite_renderer.matrices.proj;
+    const view = self.matrices.view;
+    const proj = self.matrices.proj;
 
     const p0_view = view.mulByVec3(position, 1);
     const p0_clip = proj.mulByVec3(p0_view, 1);
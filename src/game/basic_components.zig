@@ -8,6 +8,7 @@ const Mat4 = math.Mat4;
 
 const EntityId = @import("../ecs/entity.zig").EntityId;
 const World = @import("../ecs/world.zig");
+const LodScheduler = @import("../ecs/lod_scheduler.zig");
 
 const AssetDB = @import("../rendering/assetdb.zig");
 
@@ -61,3 +62,5 @@ pub const AnimatedSpriteComponent = struct {
 };
 
 pub const FollowPlayerMovementComponent = struct {};
+
+pub const LodComponent = LodScheduler.LodComponent;
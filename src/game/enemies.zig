@@ -1,7 +1,5 @@
 const std = @import("std");
 
-const imgui2 = @import("../editor/imgui2.zig");
-
 const math = @import("../math.zig");
 const Vec2 = math.Vec2;
 const Vec3 = math.Vec3;
@@ -19,7 +17,11 @@ const Profiler = @import("../editor/profiler.zig");
 const EntityId = @import("../ecs/entity.zig").EntityId;
 const World = @import("../ecs/world.zig");
 const Query = @import("../ecs/query.zig").Query;
+const Single = @import("../ecs/query.zig").Single;
+const Sliced = @import("../ecs/query.zig").Sliced;
+const Removed = @import("../ecs/observer.zig").Removed;
 const Commands = @import("../ecs/commands.zig");
+const LodScheduler = @import("../ecs/lod_scheduler.zig");
 
 const basic_components = @import("basic_components.zig");
 const Time = basic_components.Time;
@@ -30,11 +32,13 @@ const AnimatedSpriteComponent = basic_components.AnimatedSpriteComponent;
 const FollowPlayerMovementComponent = basic_components.FollowPlayerMovementComponent;
 const CameraComponent = basic_components.CameraComponent;
 const HealthComponent = basic_components.HealthComponent;
+const LodComponent = basic_components.LodComponent;
 const Player = @import("player.zig").Player;
 const PhysicsComponent = @import("physics.zig").PhysicsComponent;
 const Gem = @import("gem.zig");
+const GameSettings = @import("settings.zig").GameSettings;
 
-pub fn createDyingBat(commands: *Commands, assetdb: *AssetDB, pos: Vec3) !void {
+pub fn createDyingBat(commands: *Commands, assetdb: *const AssetDB, pos: Vec3) !void {
     var entity = .{
         .transform = TransformComponent{},
         .sprite = AnimatedSpriteComponent{ .anim = undefined, .destroy_at_end = true },
@@ -44,7 +48,7 @@ pub fn createDyingBat(commands: *Commands, assetdb: *AssetDB, pos: Vec3) !void {
     _ = try commands.createEntityBundle(&entity);
 }
 
-pub fn createBat(commands: *Commands, assetdb: *AssetDB, pos: Vec3, health: f32) !void {
+pub fn createBat(commands: *Commands, assetdb: *const AssetDB, pos: Vec3, health: f32) !void {
     var entity = .{
         .follow = FollowPlayerMovementComponent{},
         .transform = TransformComponent{},
@@ -52,6 +56,7 @@ pub fn createBat(commands: *Commands, assetdb: *AssetDB, pos: Vec3, health: f32)
         .physics = PhysicsComponent{ .own_layer = 0b0010, .target_layer = 0b0111, .radius = 10 },
         .health = HealthComponent{},
         .sprite = AnimatedSpriteComponent{ .anim = undefined },
+        .lod = LodComponent{},
     };
     entity.transform.position = pos;
     entity.health.health = health;
@@ -63,40 +68,34 @@ pub fn moveSystemFollowPlayer(
     time: *const Time,
     spawner: *EnemySpawner,
     commands: *Commands,
-    assetdb: *AssetDB,
-    players: Query(.{ Player, TransformComponent }),
-    query: Query(.{ FollowPlayerMovementComponent, TransformComponent, SpeedComponent, HealthComponent }),
+    assetdb: *const AssetDB,
+    settings: *const GameSettings,
+    lod: *const LodScheduler,
+    player_single: Single(.{ Player, TransformComponent }),
+    query: Query(.{ FollowPlayerMovementComponent, TransformComponent, SpeedComponent, HealthComponent, LodComponent }),
     gems: Query(.{ Gem.GemComponent, TransformComponent }),
 ) !void {
-    const scope = Profiler.beginScope("moveSystemFollowPlayer");
-    defer scope.end();
-
-    const max_despawn_distance = imgui2.variable(moveSystemFollowPlayer, f32, "Max despawn distance", 2000, true, .{ .min = 0 }).*;
-    const max_despawn_distance_sq = max_despawn_distance * max_despawn_distance;
-
-    const max_gem_count = imgui2.variable(moveSystemFollowPlayer, u64, "Max gem count.", 100, true, .{ .min = 0 }).*;
+    const max_gem_count = settings.enemies.max_gem_count;
 
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
         return;
 
-    var player = players.iter().next() orelse {
-        std.log.warn("moveSystemFollowPlayer: Player not found", .{});
-        return;
-    };
+    const player = player_single.get();
 
     var iter = query.iter();
     while (iter.next()) |entity| {
-        const toPlayer = player.transform.position.sub(entity.transform.position).mul(Vec3.new(1, 1, 0));
-        const vel = toPlayer.norm().scale(entity.speed.speed);
-        entity.transform.position = entity.transform.position.add(vel.scale(delta));
+        if (lod.getDelta(entity.lod.bucket, entity.ref.id)) |entity_delta| {
+            const toPlayer = player.transform.position.sub(entity.transform.position).mul(Vec3.new(1, 1, 0));
+            const vel = toPlayer.norm().scale(entity.speed.speed);
+            entity.transform.position = entity.transform.position.add(vel.scale(entity_delta));
+        }
 
-        const distance = toPlayer.lengthSq();
-        if (entity.health.health <= 0 or distance > max_despawn_distance_sq) {
+        // Enemies which are too far away are despawned by `despawnSystemFollowPlayer`.
+        if (entity.health.health <= 0) {
             try commands.destroyEntity(entity.ref.*);
             try createDyingBat(commands, assetdb, entity.transform.position);
             try spawner.gems_to_spawn.append(.{ .position = entity.transform.position, .xp = 1 });
-            spawner.current_count -= 1;
         }
     }
 
@@ -110,12 +109,70 @@ pub fn moveSystemFollowPlayer(
     spawner.gems_to_spawn.clearRetainingCapacity();
 }
 
+/// Sorts entities into level of detail buckets by their distance to the camera.
+/// Entities outside of the view are updated at 1/4 rate, entities far outside of it at 1/8 rate.
+pub fn lodBucketSystem(
+    settings: *const GameSettings,
+    camera_single: Single(.{ TransformComponent, CameraComponent }),
+    query: Sliced(.{ TransformComponent, LodComponent }, .{ .entities = 1024 }),
+) !void {
+    const far_factor = settings.enemies.lod_far_distance_factor;
+
+    const camera = camera_single.get();
+
+    // Roughly half the diagonal of a wide screen view, anything closer might be visible.
+    const view_radius_sq = camera.camera.size * camera.camera.size;
+    const far_radius_sq = view_radius_sq * far_factor * far_factor;
+
+    var iter = query.iter();
+    while (iter.next()) |entity| {
+        const distance = camera.transform.position.sub(entity.transform.position).mul(Vec3.new(1, 1, 0)).lengthSq();
+        entity.lod.bucket = if (distance <= view_radius_sq) 0 else if (distance <= far_radius_sq) 2 else 3;
+    }
+}
+
+/// Despawns enemies far away from the player. They can't reach the player anyway, so a slice per frame is enough.
+/// Has to run right after `moveSystemFollowPlayer`, which destroys enemies without health, so no enemy is destroyed twice.
+pub fn despawnSystemFollowPlayer(
+    commands: *Commands,
+    time: *const Time,
+    assetdb: *const AssetDB,
+    settings: *const GameSettings,
+    spawner: *EnemySpawner,
+    player_single: Single(.{ Player, TransformComponent }),
+    query: Sliced(.{ FollowPlayerMovementComponent, TransformComponent, HealthComponent }, .{ .entities = 256 }),
+) !void {
+    // Paused, like `moveSystemFollowPlayer`.
+    if (time.delta == 0)
+        return;
+
+    const max_despawn_distance = settings.enemies.max_despawn_distance;
+    const max_despawn_distance_sq = max_despawn_distance * max_despawn_distance;
+
+    const player = player_single.get();
+
+    var iter = query.iter();
+    while (iter.next()) |entity| {
+        if (entity.health.health <= 0)
+            continue;
+
+        const distance = player.transform.position.sub(entity.transform.position).mul(Vec3.new(1, 1, 0)).lengthSq();
+        if (distance > max_despawn_distance_sq) {
+            try commands.destroyEntity(entity.ref.*);
+            try createDyingBat(commands, assetdb, entity.transform.position);
+            try spawner.gems_to_spawn.append(.{ .position = entity.transform.position, .xp = 1 });
+        }
+    }
+}
+
 pub const GemToSpawn = struct {
     position: Vec3,
     xp: f32,
 };
 
 pub const EnemySpawner = struct {
+    /// Enemies which were spawned and not destroyed yet.
+    /// Increased when spawning and decreased by `enemySpawnSystem` when it gets notified about destroyed enemies.
     current_count: u64 = 0,
     world: *World,
     prng: std.rand.DefaultPrng,
@@ -143,21 +200,20 @@ pub fn enemySpawnSystem(
     time: *const Time,
     spawner: *EnemySpawner,
     commands: *Commands,
-    assetdb: *AssetDB,
-    players: Query(.{ Player, TransformComponent, CameraComponent }),
+    assetdb: *const AssetDB,
+    settings: *const GameSettings,
+    player_single: Single(.{ Player, TransformComponent, CameraComponent }),
+    despawned: Removed(FollowPlayerMovementComponent),
 ) !void {
-    var player = players.iter().next() orelse {
-        std.log.warn("moveSystemFollowPlayer: Player not found", .{});
-        return;
-    };
+    spawner.current_count -|= despawned.entities.len;
+
+    const player = player_single.get();
 
-    const min_spawn_distance = imgui2.variable(enemySpawnSystem, f32, "Spawn distance", 200, true, .{ .min = 0 }).*;
-    const spawn_distance_width = imgui2.variable(enemySpawnSystem, f32, "Spawn distance width", 200, true, .{ .min = 0 }).*;
-    const max_spawn_distance = min_spawn_distance + spawn_distance_width;
+    const min_spawn_distance = settings.enemies.spawn_distance;
+    const max_spawn_distance = min_spawn_distance + settings.enemies.spawn_distance_width;
 
-    const desired_count = imgui2.variable(enemySpawnSystem, i32, "Desired enemies", 10, true, .{ .min = 0 }).*;
-    const base_health = imgui2.variable(enemySpawnSystem, f32, "Bat health", 10, true, .{ .min = 0, .speed = 0.1 }).*;
-    const health = base_health;
+    const desired_count = settings.enemies.desired_count;
+    const health = settings.enemies.health;
 
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
@@ -1,4 +1,5 @@
 pub usingnamespace @import("basic_components.zig");
+pub usingnamespace @import("settings.zig");
 pub usingnamespace @import("player.zig");
 pub usingnamespace @import("rendering.zig");
 pub usingnamespace @import("weapons/bible.zig");
@@ -6,3 +7,5 @@ pub usingnamespace @import("weapons/axe.zig");
 pub usingnamespace @import("enemies.zig");
 pub usingnamespace @import("gem.zig");
 pub usingnamespace @import("physics.zig");
+pub usingnamespace @import("simulation.zig");
+pub usingnamespace @import("replay.zig");
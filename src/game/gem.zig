@@ -1,7 +1,5 @@
 const std = @import("std");
 
-const imgui2 = @import("../editor/imgui2.zig");
-
 const math = @import("../math.zig");
 const Vec2 = math.Vec2;
 const Vec3 = math.Vec3;
@@ -19,6 +17,7 @@ const Profiler = @import("../editor/profiler.zig");
 const EntityId = @import("/../ecs/entity.zig").EntityId;
 const World = @import("../ecs/world.zig");
 const Query = @import("../ecs/query.zig").Query;
+const Single = @import("../ecs/query.zig").Single;
 const Commands = @import("../ecs/commands.zig");
 
 const basic_components = @import("basic_components.zig");
@@ -29,13 +28,14 @@ const SpriteComponent = basic_components.SpriteComponent;
 const AnimatedSpriteComponent = basic_components.AnimatedSpriteComponent;
 const HealthComponent = basic_components.HealthComponent;
 const Player = @import("player.zig").Player;
+const GameSettings = @import("settings.zig").GameSettings;
 
 pub const GemComponent = struct {
     follow_player: bool = false,
     xp: f32 = 0,
 };
 
-pub fn createGem(commands: *Commands, assetdb: *AssetDB, position: Vec3, xp: f32) !void {
+pub fn createGem(commands: *Commands, assetdb: *const AssetDB, position: Vec3, xp: f32) !void {
     var entity = .{
         .gem = GemComponent{},
         .transform = TransformComponent{},
@@ -43,30 +43,23 @@ pub fn createGem(commands: *Commands, assetdb: *AssetDB, position: Vec3, xp: f32
     };
     entity.gem.xp = xp;
     entity.transform.position = position;
-    entity.sprite.texture = try assetdb.getTextureByPath("Gem1.png", .{});
+    entity.sprite.texture = assetdb.findTextureByPath("Gem1.png") orelse return error.TextureNotLoaded;
     _ = try commands.createEntityBundle(&entity);
 }
 
 pub fn gemSystem(
     time: *const Time,
     commands: *Commands,
-    player_query: Query(.{ Player, TransformComponent }),
+    settings: *const GameSettings,
+    player_single: Single(.{ Player, TransformComponent }),
     query: Query(.{ GemComponent, TransformComponent }),
 ) !void {
-    const player = player_query.iter().next() orelse {
-        std.log.err("gemSystem: No player found.", .{});
-        return;
-    };
-
-    const base_attract_distance = imgui2.variable(gemSystem, f32, "Gem attract area", 100, true, .{ .min = 1, .speed = 0.1 }).*;
-    const attract_distance = base_attract_distance * player.player.attract_range_modifier;
-
-    const gem_radius = imgui2.variable(gemSystem, f32, "Gem radius", 20, true, .{ .min = 1, .speed = 0.1 }).*;
-
-    const base_xp_modifier = imgui2.variable(gemSystem, f32, "Gem xp multiplier", 1, true, .{ .min = 0.1 }).*;
-    const xp_modifier = base_xp_modifier * player.player.xp_modifier;
+    const player = player_single.get();
 
-    const gem_speed = imgui2.variable(gemSystem, f32, "Gem speed", 350, true, .{ .min = 0.1 }).*;
+    const attract_distance = settings.gem.attract_area * player.player.attract_range_modifier;
+    const gem_radius = settings.gem.radius;
+    const xp_modifier = settings.gem.xp_multiplier * player.player.xp_modifier;
+    const gem_speed = settings.gem.speed;
 
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
@@ -11,7 +11,6 @@ const Vec3 = math.Vec3;
 const Vec4 = math.Vec4;
 const Mat4 = math.Mat4;
 
-const SpriteRenderer = @import("../rendering/sprite_renderer.zig");
 const Profiler = @import("../editor/profiler.zig");
 const Viewport = @import("../editor/viewport.zig");
 
@@ -22,6 +21,7 @@ const EntityRef = Entity.Ref;
 
 const World = @import("../ecs/world.zig");
 const Query = @import("../ecs/query.zig").Query;
+const Single = @import("../ecs/query.zig").Single;
 const Commands = @import("../ecs/commands.zig");
 
 const basic_components = @import("basic_components.zig");
@@ -29,7 +29,7 @@ const Time = basic_components.Time;
 const TransformComponent = basic_components.TransformComponent;
 const SpeedComponent = basic_components.SpeedComponent;
 const Player = @import("player.zig").Player;
-const EnemySpawner = @import("enemies.zig").EnemySpawner;
+const GameSettings = @import("settings.zig").GameSettings;
 
 const PhysicsQuery = Query(.{ TransformComponent, PhysicsComponent });
 const EntityHandle = PhysicsQuery.EntityHandle;
@@ -350,27 +350,16 @@ pub const PhysicsScene = struct {
 
 pub fn physicsSystem(
     time: *const Time,
-    sprite_renderer: *SpriteRenderer,
-    commands: *Commands,
-    spawner: *EnemySpawner,
+    settings: *const GameSettings,
     scene: *PhysicsScene,
-    viewport: *Viewport,
     query: PhysicsQuery,
-    grid_centers: Query(.{ GridCenterComponent, TransformComponent }),
+    grid_center_single: Single(.{ GridCenterComponent, TransformComponent }),
 ) !void {
-    const scope = Profiler.beginScope("physicsSystem");
-    defer scope.end();
-
-    const draw_debug_entities = imgui2.variable(physicsSystem, bool, "(Physics) Draw entities", false, true, .{}).*;
-
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
         return;
 
-    var grid_center = grid_centers.iter().next() orelse {
-        std.log.warn("physicsSystem: No grid center found.", .{});
-        return;
-    };
+    const grid_center = grid_center_single.get();
 
     scene.clearGrid();
     scene.setCenterLocation(grid_center.transform.position.xy());
@@ -380,10 +369,6 @@ pub fn physicsSystem(
     {
         var iter = query.iter();
         while (iter.next()) |entity| {
-            if (draw_debug_entities) {
-                try drawDebugInfoForEntity(sprite_renderer, entity);
-            }
-
             try scene.insertEntity(entity);
 
             // Also reset some stuff.
@@ -392,17 +377,10 @@ pub fn physicsSystem(
         }
     }
 
-    if (imgui2.variable(physicsSystem, bool, "(Physics) Draw grid", false, true, .{}).*) {
-        try drawDebugGrid(scene, viewport);
-    }
-
     // Find possible collision pairs.
     scene.potential_collisions.clearRetainingCapacity();
     scene.manifolds.clearRetainingCapacity();
 
-    _ = spawner;
-    _ = commands;
-
     var y: i64 = 0;
     while (y < @intCast(i64, scene.grid_size) - 1) : (y += 1) {
         var x: i64 = 0;
@@ -443,16 +421,6 @@ pub fn physicsSystem(
         }
     }
 
-    imgui2.variable(physicsSystem, usize, "EntityHandlePairs", 0, true, .{}).* = scene.potential_collisions.items.len;
-
-    const count = query.count();
-    imgui2.variable(physicsSystem, usize, "Entities Sq", 0, true, .{}).* = count * count;
-
-    if (imgui2.variable(physicsSystem, bool, "Draw potential collisions", false, true, .{}).*) {
-        // Draw potential_collisions
-        try drawDebugEntityHandlePairs(scene, viewport);
-    }
-
     for (scene.potential_collisions.items) |pair| {
         if (Manifold.circleVsCircle(pair.a, pair.b)) |m| {
             try scene.manifolds.append(m);
@@ -469,13 +437,6 @@ pub fn physicsSystem(
         }
     }
 
-    imgui2.variable(physicsSystem, usize, "Manifolds", 0, true, .{}).* = scene.manifolds.items.len;
-
-    if (imgui2.variable(physicsSystem, bool, "Draw actual collisions", false, true, .{}).*) {
-        // Draw potential_collisions
-        try drawDebugManifolds(scene, viewport);
-    }
-
     // Collect collisions
     for (scene.manifolds.items) |*m| {
         const a = m.a;
@@ -491,7 +452,7 @@ pub fn physicsSystem(
     // Integrate forces
 
     // Solve collisions
-    var iterations = imgui2.variable(physicsSystem, u64, "(Physics) Solve iterations", 1, true, .{}).*;
+    var iterations = settings.physics.solve_iterations;
     while (iterations > 0) : (iterations -= 1) {}
 
     // Integrate velocities
@@ -504,6 +465,39 @@ pub fn physicsSystem(
     // Clear all forces
 }
 
+/// Editor only, shows what `physicsSystem` computed this frame, so it has to run after it in the same stage.
+pub fn physicsDebugSystem(
+    scene: *PhysicsScene,
+    viewport: *Viewport,
+    query: PhysicsQuery,
+) !void {
+    if (imgui2.variable(physicsDebugSystem, bool, "(Physics) Draw entities", false, true, .{}).*) {
+        var iter = query.iter();
+        while (iter.next()) |entity| {
+            try drawDebugInfoForEntity(viewport, entity);
+        }
+    }
+
+    if (imgui2.variable(physicsDebugSystem, bool, "(Physics) Draw grid", false, true, .{}).*) {
+        try drawDebugGrid(scene, viewport);
+    }
+
+    imgui2.variable(physicsDebugSystem, usize, "EntityHandlePairs", 0, true, .{}).* = scene.potential_collisions.items.len;
+
+    const count = query.count();
+    imgui2.variable(physicsDebugSystem, usize, "Entities Sq", 0, true, .{}).* = count * count;
+
+    if (imgui2.variable(physicsDebugSystem, bool, "Draw potential collisions", false, true, .{}).*) {
+        try drawDebugEntityHandlePairs(scene, viewport);
+    }
+
+    imgui2.variable(physicsDebugSystem, usize, "Manifolds", 0, true, .{}).* = scene.manifolds.items.len;
+
+    if (imgui2.variable(physicsDebugSystem, bool, "Draw actual collisions", false, true, .{}).*) {
+        try drawDebugManifolds(scene, viewport);
+    }
+}
+
 pub fn drawDebugEntityHandlePairs(
     scene: *PhysicsScene,
     viewport: *Viewport,
@@ -621,7 +615,7 @@ pub fn drawDebugGrid(
 }
 
 pub fn drawDebugInfoForEntity(
-    sprite_renderer: *SpriteRenderer,
+    viewport: *Viewport,
     entity: *const EntityHandle,
 ) !void {
     const open = imgui.Begin("Viewport");
@@ -642,21 +636,8 @@ pub fn drawDebugInfoForEntity(
         const size = Vec2.set(entity.transform.size * entity.physics.radius);
 
         // Transform positions into screen space
-        const view = sprite_renderer.matrices.view;
-        const proj = sprite_renderer.matrices.proj;
-        const screen = Mat4.orthographic(canvas_p0.x(), canvas_p1.x(), canvas_p0.y(), canvas_p1.y(), 1, -1).inv();
-
-        const p0_world = Vec3.new(position.x(), position.y(), 0);
-        const p1_world = Vec3.new(position.x() + size.x(), position.y(), 0);
-        const p0_view = view.mulByVec3(p0_world, 1);
-        const p1_view = view.mulByVec3(p1_world, 1);
-        const p0_clip = proj.mulByVec3(p0_view, 1);
-        const p1_clip = proj.mulByVec3(p1_view, 1);
-        const p0_screen = screen.mulByVec3(p0_clip, 1);
-        const p1_screen = screen.mulByVec3(p1_clip, 1);
-
-        const p0 = Vec2.new(p0_screen.x(), p0_screen.y());
-        const p1 = Vec2.new(p1_screen.x(), p1_screen.y());
+        const p0 = viewport.world2ToViewport(position.xy());
+        const p1 = viewport.world2ToViewport(Vec2.new(position.x() + size.x(), position.y()));
         const radius = p0.sub(p1).length();
 
         const color = imgui.ColorConvertFloat4ToU32(.{ .x = 0.15, .y = 0.5, .z = 1, .w = 1 });
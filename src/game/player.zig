@@ -16,14 +16,20 @@ const World = @import("../ecs/world.zig");
 const Query = @import("../ecs/query.zig").Query;
 const Commands = @import("../ecs/commands.zig");
 
+const AssetDB = @import("../rendering/assetdb.zig");
+
 const basic_components = @import("basic_components.zig");
 const Time = basic_components.Time;
 const Input = basic_components.Input;
 const TransformComponent = basic_components.TransformComponent;
 const SpeedComponent = basic_components.SpeedComponent;
+const CameraComponent = basic_components.CameraComponent;
+const HealthComponent = basic_components.HealthComponent;
+const AnimatedSpriteComponent = basic_components.AnimatedSpriteComponent;
 
 const physics = @import("physics.zig");
 const PhysicsComponent = physics.PhysicsComponent;
+const GridCenterComponent = physics.GridCenterComponent;
 
 pub const Player = struct {
     area_modifier: f32 = 1,
@@ -42,6 +48,21 @@ pub const Player = struct {
     velocity: Vec3 = Vec3.zero(),
 };
 
+pub fn createPlayer(commands: *Commands, assetdb: *const AssetDB, position: Vec3) !void {
+    var player = .{
+        .player = Player{},
+        .transform = TransformComponent{ .position = position, .size = 1 },
+        .speed = SpeedComponent{ .speed = 150 },
+        .camera = CameraComponent{ .size = 1000 },
+        .physics = PhysicsComponent{ .own_layer = 0b0001, .target_layer = 0b0010, .radius = 15, .inverse_mass = 0 },
+        .health = HealthComponent{ .health = 100 },
+        .grid_center = GridCenterComponent{},
+        .sprite = AnimatedSpriteComponent{ .anim = undefined },
+    };
+    player.sprite.anim = assetdb.getSpriteAnimation("Antonio") orelse return error.SpriteAnimationNotFound;
+    _ = try commands.createEntityBundle(&player);
+}
+
 pub fn moveSystemPlayer(
     time: *const Time,
     input: *const Input,
@@ -19,7 +19,9 @@ const Profiler = @import("../editor/profiler.zig");
 
 const World = @import("../ecs/world.zig");
 const Query = @import("../ecs/query.zig").Query;
+const Single = @import("../ecs/query.zig").Single;
 const Commands = @import("../ecs/commands.zig");
+const LodScheduler = @import("../ecs/lod_scheduler.zig");
 
 const basic_components = @import("basic_components.zig");
 const Time = basic_components.Time;
@@ -28,93 +30,188 @@ const SpriteComponent = basic_components.SpriteComponent;
 const AnimatedSpriteComponent = basic_components.AnimatedSpriteComponent;
 const CameraComponent = basic_components.CameraComponent;
 
-pub fn spriteRenderSystem(
-    renderer: *Renderer,
-    sprite_renderer: *SpriteRenderer,
-    commands: *Commands,
-    time: *const Time,
-    cameras: Query(.{ TransformComponent, CameraComponent }),
-    sprite_query: Query(.{ TransformComponent, SpriteComponent }),
-    animated_sprite_query: Query(.{ TransformComponent, AnimatedSpriteComponent }),
-) !void {
-    const scope = Profiler.beginScope("animatedSpriteRenderSystem");
-    defer scope.end();
+/// Animations of sprites outside of the view are only advanced every 4th frame.
+const off_screen_lod_bucket = 2;
 
-    const delta = @floatCast(f32, time.delta);
+/// Everything `spriteRenderSystem` needs to draw one sprite.
+pub const SpriteInstance = struct {
+    position: Vec3,
+    size: Vec2,
+    rotation: f32,
+    texture: *AssetDB.TextureAsset,
+    tiling: Vec2,
+    id: u32,
+};
+
+/// Data of one frame extracted from the world by `spriteExtractSystem`.
+pub const RenderSnapshot = struct {
+    /// Identity until the first extraction, which is rendered in the first pipelined frame.
+    matrices: SpriteRenderer.SceneMatricesUbo = .{ .view = Mat4.identity(), .proj = Mat4.identity() },
+    /// Only sprites which passed culling.
+    sprites: std.ArrayList(SpriteInstance),
+
+    animated: u64 = 0,
+    not_animated: u64 = 0,
+    culled: u64 = 0,
+
+    fn clear(self: *@This()) void {
+        self.sprites.clearRetainingCapacity();
+        self.animated = 0;
+        self.not_animated = 0;
+        self.culled = 0;
+    }
+};
+
+/// Resource with two render snapshots. `spriteExtractSystem` writes the back snapshot, `spriteRenderSystem` only reads the front one.
+/// Because render systems don't access the world, they can record frame N on another thread while frame N + 1 is simulated.
+/// `swap` has to be called in between, when neither of them runs.
+pub const RenderExtraction = struct {
+    snapshots: [2]RenderSnapshot,
+    back_index: u1 = 0,
+
+    pub fn init(allocator: Allocator) @This() {
+        return @This(){
+            .snapshots = .{
+                .{ .sprites = std.ArrayList(SpriteInstance).init(allocator) },
+                .{ .sprites = std.ArrayList(SpriteInstance).init(allocator) },
+            },
+        };
+    }
+
+    pub fn deinit(self: *const @This()) void {
+        for (self.snapshots) |*snapshot| {
+            snapshot.sprites.deinit();
+        }
+    }
+
+    pub fn back(self: *@This()) *RenderSnapshot {
+        return &self.snapshots[self.back_index];
+    }
+
+    pub fn front(self: *const @This()) *const RenderSnapshot {
+        return &self.snapshots[self.back_index +% 1];
+    }
 
-    var camera_half_width: f32 = 1000000;
-    var camera_half_height: f32 = 1000000;
-    var cull_center = Vec2.zero();
+    pub fn swap(self: *@This()) void {
+        self.back_index +%= 1;
+    }
+};
+
+/// View of the camera, shared by the systems which need to know what is visible.
+const View = struct {
+    matrices: SpriteRenderer.SceneMatricesUbo,
+    cull_rect_min: Vec2,
+    cull_rect_max: Vec2,
 
-    if (cameras.iter().next()) |camera| {
+    fn init(renderer: *const Renderer, camera: anytype) View {
         const height = std.math.max(camera.camera.size, 1);
         const aspect_ratio = @intToFloat(f32, renderer.current_scene_extent.width) / @intToFloat(f32, renderer.current_scene_extent.height);
 
-        const matrices = SpriteRenderer.SceneMatricesUbo{
-            // x needs to be flipped because the view matrix is the inverse of the camera transform
-            // y needs to not be flipped because in vulkan y is flipped.
-            .view = Mat4.fromTranslate(Vec3.fromSlice(&.{ -camera.transform.position.x(), -camera.transform.position.y(), 0 })),
-            .proj = Mat4.orthographic(-height * aspect_ratio * 0.5, height * aspect_ratio * 0.5, height * 0.5, -height * 0.5, -500, 1000),
+        // Use 0.6 for a bit of buffer around the edge.
+        const camera_half_width = height * aspect_ratio * 0.6;
+        const camera_half_height = height * 0.6;
+        const cull_center = Vec2.new(camera.transform.position.x(), camera.transform.position.y());
+
+        return View{
+            .matrices = .{
+                // x needs to be flipped because the view matrix is the inverse of the camera transform
+                // y needs to not be flipped because in vulkan y is flipped.
+                .view = Mat4.fromTranslate(Vec3.fromSlice(&.{ -camera.transform.position.x(), -camera.transform.position.y(), 0 })),
+                .proj = Mat4.orthographic(-height * aspect_ratio * 0.5, height * aspect_ratio * 0.5, height * 0.5, -height * 0.5, -500, 1000),
+            },
+            .cull_rect_min = cull_center.sub(Vec2.new(camera_half_width, camera_half_height)),
+            .cull_rect_max = cull_center.add(Vec2.new(camera_half_width, camera_half_height)),
         };
+    }
 
-        // Use 0.6 for a bit of buffer around the edge.
-        camera_half_width = height * aspect_ratio * 0.6;
-        camera_half_height = height * 0.6;
-        cull_center = Vec2.new(camera.transform.position.x(), camera.transform.position.y());
+    /// Used without a camera, nothing is culled.
+    fn initWithoutCamera() View {
+        return View{
+            .matrices = .{ .view = Mat4.identity(), .proj = Mat4.identity() },
+            .cull_rect_min = Vec2.new(-1000000, -1000000),
+            .cull_rect_max = Vec2.new(1000000, 1000000),
+        };
+    }
 
-        try sprite_renderer.updateCameraData(&matrices);
-    } else {
-        std.log.warn("spriteRenderSystem: No camera found", .{});
+    fn isVisible(self: *const View, position: Vec3, texture_size: Vec2) bool {
+        const rect_min = position.xy().sub(texture_size.scale(0.5));
+        const rect_max = rect_min.add(texture_size);
+        return rect_min.x() < self.cull_rect_max.x() and rect_max.x() > self.cull_rect_min.x() and rect_min.y() < self.cull_rect_max.y() and rect_max.y() > self.cull_rect_min.y();
     }
+};
 
-    const cull_rect_min = cull_center.sub(Vec2.new(camera_half_width, camera_half_height));
-    const cull_rect_max = cull_center.add(Vec2.new(camera_half_width, camera_half_height));
+/// Advances sprite animations and destroys entities whose animation ended.
+/// Doesn't depend on the renderer, so it also runs without one.
+pub fn spriteAnimationSystem(
+    commands: *Commands,
+    time: *const Time,
+    lod: *const LodScheduler,
+    camera_single: Single(.{ TransformComponent, CameraComponent }),
+    animated_sprite_query: Query(.{ TransformComponent, AnimatedSpriteComponent }),
+) !void {
+    const delta = @floatCast(f32, time.delta);
+
+    // Roughly half the diagonal of a wide screen view, like `lodBucketSystem`.
+    const camera = camera_single.get();
+    const view_radius_sq = camera.camera.size * camera.camera.size;
+
+    var iter = animated_sprite_query.iter();
+    while (iter.next()) |entity| {
+        const visible = camera.transform.position.sub(entity.transform.position).mul(Vec3.new(1, 1, 0)).lengthSq() <= view_radius_sq;
+
+        const animation_delta = if (visible) delta else lod.getDelta(off_screen_lod_bucket, entity.ref.id) orelse 0;
+        if (animation_delta <= 0)
+            continue;
 
-    var rendered_entities: usize = 0;
-    var culled_entities: usize = 0;
-    var animated: usize = 0;
-    var not_animated: usize = 0;
+        entity.animated_sprite.time += animation_delta;
+        while (entity.animated_sprite.time >= entity.animated_sprite.anim.length) {
+            entity.animated_sprite.time -= entity.animated_sprite.anim.length;
+            if (entity.animated_sprite.destroy_at_end) {
+                _ = try commands.destroyEntity(entity.ref.*);
+                break;
+            }
+        }
+    }
+}
+
+/// Copies the camera and all visible sprites into the back snapshot of `RenderExtraction`.
+/// Takes the cameras as a query instead of a `Single`, so the snapshot is still updated without a camera.
+pub fn spriteExtractSystem(
+    renderer: *const Renderer,
+    extraction: *RenderExtraction,
+    cameras: Query(.{ TransformComponent, CameraComponent }),
+    sprite_query: Query(.{ TransformComponent, SpriteComponent }),
+    animated_sprite_query: Query(.{ TransformComponent, AnimatedSpriteComponent }),
+) !void {
+    const view = if (cameras.iter().next()) |camera| View.init(renderer, camera) else blk: {
+        std.log.warn("spriteExtractSystem: No camera found", .{});
+        break :blk View.initWithoutCamera();
+    };
+
+    var snapshot = extraction.back();
+    snapshot.clear();
+    snapshot.matrices = view.matrices;
 
     // Animated Sprites
     {
         var iter = animated_sprite_query.iter();
-        entity_loop: while (iter.next()) |entity| {
-            animated += 1;
-
-            const position = entity.transform.position;
-            const rotation = entity.transform.rotation;
-            const size = entity.transform.size;
-
-            if (delta > 0) {
-                //
-                entity.animated_sprite.time += delta;
-                while (entity.animated_sprite.time >= entity.animated_sprite.anim.length) {
-                    entity.animated_sprite.time -= entity.animated_sprite.anim.length;
-                    if (entity.animated_sprite.destroy_at_end) {
-                        _ = try commands.destroyEntity(entity.ref.*);
-                        continue :entity_loop;
-                    }
-                }
-            }
+        while (iter.next()) |entity| {
+            snapshot.animated += 1;
 
             const texture = entity.animated_sprite.getCurrentTexture();
-            const texture_size: Vec2 = texture.getSize().scale(size);
-
-            const rect_min = position.xy().sub(texture_size.scale(0.5));
-            const rect_max = rect_min.add(texture_size);
-
-            if (rect_min.x() < cull_rect_max.x() and rect_max.x() > cull_rect_min.x() and rect_min.y() < cull_rect_max.y() and rect_max.y() > cull_rect_min.y()) {
-                sprite_renderer.drawSprite(
-                    position,
-                    texture_size,
-                    rotation,
-                    texture,
-                    Vec2.new(1, 1),
-                    @intCast(u32, entity.ref.id),
-                );
-                rendered_entities += 1;
+            const texture_size: Vec2 = texture.getSize().scale(entity.transform.size);
+
+            if (view.isVisible(entity.transform.position, texture_size)) {
+                try snapshot.sprites.append(.{
+                    .position = entity.transform.position,
+                    .size = texture_size,
+                    .rotation = entity.transform.rotation,
+                    .texture = texture,
+                    .tiling = Vec2.new(1, 1),
+                    .id = @intCast(u32, entity.ref.id),
+                });
             } else {
-                culled_entities += 1;
+                snapshot.culled += 1;
             }
         }
     }
@@ -123,29 +220,21 @@ pub fn spriteRenderSystem(
     {
         var iter = sprite_query.iter();
         while (iter.next()) |entity| {
-            not_animated += 1;
-
-            const position = entity.transform.position;
-            const rotation = entity.transform.rotation;
-            const size = entity.transform.size;
-
-            const texture_size: Vec2 = entity.sprite.texture.getSize().scale(size);
-
-            const rect_min = position.xy().sub(texture_size.scale(0.5));
-            const rect_max = rect_min.add(texture_size);
-
-            if (rect_min.x() < cull_rect_max.x() and rect_max.x() > cull_rect_min.x() and rect_min.y() < cull_rect_max.y() and rect_max.y() > cull_rect_min.y()) {
-                sprite_renderer.drawSprite(
-                    position,
-                    texture_size,
-                    rotation,
-                    entity.sprite.texture,
-                    entity.sprite.tiling,
-                    @intCast(u32, entity.ref.id),
-                );
-                rendered_entities += 1;
+            snapshot.not_animated += 1;
+
+            const texture_size: Vec2 = entity.sprite.texture.getSize().scale(entity.transform.size);
+
+            if (view.isVisible(entity.transform.position, texture_size)) {
+                try snapshot.sprites.append(.{
+                    .position = entity.transform.position,
+                    .size = texture_size,
+                    .rotation = entity.transform.rotation,
+                    .texture = entity.sprite.texture,
+                    .tiling = entity.sprite.tiling,
+                    .id = @intCast(u32, entity.ref.id),
+                });
             } else {
-                culled_entities += 1;
+                snapshot.culled += 1;
             }
         }
     }
@@ -153,11 +242,26 @@ pub fn spriteRenderSystem(
     const open = imgui.Begin("Stats");
     defer imgui.End();
     if (open) {
-        var total = animated + not_animated;
+        var total = snapshot.animated + snapshot.not_animated;
+        var rendered = snapshot.sprites.items.len;
         imgui2.any(&total, "Total sprites", .{});
-        imgui2.any(&animated, "Animated sprites", .{});
-        imgui2.any(&not_animated, "Normal sprites", .{});
-        imgui2.any(&culled_entities, "Culled", .{});
-        imgui2.any(&rendered_entities, "Rendered", .{});
+        imgui2.any(&snapshot.animated, "Animated sprites", .{});
+        imgui2.any(&snapshot.not_animated, "Normal sprites", .{});
+        imgui2.any(&snapshot.culled, "Culled", .{});
+        imgui2.any(&rendered, "Rendered", .{});
+    }
+}
+
+/// Draws the front snapshot of `RenderExtraction`. Doesn't access the world, see `RenderExtraction`.
+pub fn spriteRenderSystem(
+    sprite_renderer: *SpriteRenderer,
+    extraction: *const RenderExtraction,
+) !void {
+    const snapshot = extraction.front();
+
+    try sprite_renderer.updateCameraData(&snapshot.matrices);
+
+    for (snapshot.sprites.items) |*sprite| {
+        sprite_renderer.drawSprite(sprite.position, sprite.size, sprite.rotation, sprite.texture, sprite.tiling, sprite.id);
     }
 }
@@ -0,0 +1,250 @@
+//! Records the input, delta time and settings of every frame into a compact binary log, together with a hash of the
+//! commands applied in that frame, so a session can be replayed exactly, e.g. by the headless build for benchmarks.
+//! Replaying compares the commands of every frame with the recording and fails at the first frame which diverges.
+//!
+//! Format, all values little endian:
+//!   header: "ZRPL", version: u32, first_entity_id: u64, start_time: f64
+//!   frame:  flags: u8 (bit 0-3 left/right/up/down, bit 7 settings follow), delta: f64, [settings],
+//!           command_count: u32, command_hash: u64
+//! Settings are only written in the first frame and when they change, field by field in declaration order.
+//!
+//! A recording only replays correctly if the world was in the same state when recording started, i.e. right after
+//! the game was set up. Editor actions like creating or destroying entities are recorded as commands but not replayed.
+
+const std = @import("std");
+
+const Entity = @import("../ecs/entity.zig");
+const EntityId = Entity.EntityId;
+const World = @import("../ecs/world.zig");
+const Commands = @import("../ecs/commands.zig");
+
+const basic_components = @import("basic_components.zig");
+const Time = basic_components.Time;
+const Input = basic_components.Input;
+const GameSettings = @import("settings.zig").GameSettings;
+
+const magic = "ZRPL";
+const version: u32 = 1;
+
+const settings_flag: u8 = 1 << 7;
+
+pub const ReplayHeader = struct {
+    /// Next entity id of the world when recording started.
+    first_entity_id: EntityId,
+    start_time: f64,
+};
+
+pub const ReplayFrame = struct {
+    input: Input,
+    delta: f64,
+    /// Only set if the settings changed since the last frame, always set in the first frame.
+    settings: ?GameSettings = null,
+    command_count: u64,
+    /// `Commands.stream_hash` after the frame, so it covers all frames up to this one.
+    command_hash: u64,
+};
+
+pub const ReplayRecorder = struct {
+    const Self = @This();
+
+    file: std.fs.File,
+    buffered_writer: std.io.BufferedWriter(4096, std.fs.File.Writer),
+    last_settings: ?GameSettings = null,
+
+    /// Starts recording from the current state of the world and enables hashing of the applied commands.
+    pub fn init(path: []const u8, world: *World, commands: *Commands, time: *const Time) !Self {
+        const file = try std.fs.cwd().createFile(path, .{});
+        errdefer file.close();
+
+        var self = Self{
+            .file = file,
+            .buffered_writer = std.io.bufferedWriter(file.writer()),
+        };
+
+        const writer = self.buffered_writer.writer();
+        try writer.writeAll(magic);
+        try writer.writeIntLittle(u32, version);
+        try writeValue(writer, ReplayHeader{ .first_entity_id = world.nextEntityId, .start_time = time.now });
+
+        commands.hash_stream = true;
+        commands.stream_hash = 0;
+
+        return self;
+    }
+
+    pub fn deinit(self: *Self) void {
+        self.buffered_writer.flush() catch |err| {
+            std.log.err("Failed to write replay: {}", .{err});
+        };
+        self.file.close();
+    }
+
+    /// Has to be called after all commands of the frame were applied and before `World.endFrame`.
+    pub fn recordFrame(self: *Self, world: *const World, commands: *const Commands, input: Input, time: Time, settings: GameSettings) !void {
+        const writer = self.buffered_writer.writer();
+
+        const settings_changed = if (self.last_settings) |last| !std.meta.eql(last, settings) else true;
+        var flags = inputToFlags(input);
+        if (settings_changed) {
+            flags |= settings_flag;
+        }
+
+        try writer.writeByte(flags);
+        try writeValue(writer, time.delta);
+        if (settings_changed) {
+            try writeValue(writer, settings);
+            self.last_settings = settings;
+        }
+        try writer.writeIntLittle(u32, @intCast(u32, world.counters.frame_commands_applied));
+        try writer.writeIntLittle(u64, commands.stream_hash);
+    }
+};
+
+pub const Replay = struct {
+    const Self = @This();
+
+    allocator: std.mem.Allocator,
+    header: ReplayHeader,
+    frames: []ReplayFrame,
+
+    pub fn load(allocator: std.mem.Allocator, path: []const u8) !Self {
+        const data = try std.fs.cwd().readFileAlloc(allocator, path, std.math.maxInt(u32));
+        defer allocator.free(data);
+
+        var stream = std.io.fixedBufferStream(data);
+        const reader = stream.reader();
+
+        if (!std.mem.eql(u8, &(try reader.readBytesNoEof(magic.len)), magic)) {
+            return error.InvalidReplay;
+        }
+        if ((try reader.readIntLittle(u32)) != version) {
+            return error.UnsupportedReplayVersion;
+        }
+        const header = try readValue(ReplayHeader, reader);
+
+        var frames = std.ArrayList(ReplayFrame).init(allocator);
+        errdefer frames.deinit();
+
+        while (stream.pos < data.len) {
+            const flags = try reader.readByte();
+            var frame = ReplayFrame{
+                .input = flagsToInput(flags),
+                .delta = try readValue(f64, reader),
+                .command_count = undefined,
+                .command_hash = undefined,
+            };
+            if (flags & settings_flag != 0) {
+                frame.settings = try readValue(GameSettings, reader);
+            } else if (frames.items.len == 0) {
+                return error.InvalidReplay;
+            }
+            frame.command_count = try reader.readIntLittle(u32);
+            frame.command_hash = try reader.readIntLittle(u64);
+            try frames.append(frame);
+        }
+
+        return Self{
+            .allocator = allocator,
+            .header = header,
+            .frames = frames.toOwnedSlice(),
+        };
+    }
+
+    pub fn deinit(self: *const Self) void {
+        self.allocator.free(self.frames);
+    }
+
+    /// Has to be called right after the game was set up, before the first frame.
+    /// Skips the entity ids which were used by entities only the recording session created, e.g. the editor's background.
+    pub fn begin(self: *const Self, world: *World, commands: *Commands, time: *Time) !void {
+        if (world.nextEntityId > self.header.first_entity_id) {
+            return error.ReplayWorldMismatch;
+        }
+        world.nextEntityId = self.header.first_entity_id;
+        time.now = self.header.start_time;
+
+        commands.hash_stream = true;
+        commands.stream_hash = 0;
+    }
+
+    /// Sets the input, time and settings of frame `index` before its systems run.
+    pub fn applyFrame(self: *const Self, index: usize, input: *Input, time: *Time, settings: *GameSettings) void {
+        const frame = &self.frames[index];
+        input.* = frame.input;
+        time.delta = frame.delta;
+        time.now += frame.delta;
+        if (frame.settings) |frame_settings| {
+            settings.* = frame_settings;
+        }
+    }
+
+    /// Compares the commands applied in frame `index` with the recording.
+    /// Has to be called after all commands of the frame were applied and before `World.endFrame`.
+    pub fn verifyFrame(self: *const Self, index: usize, world: *const World, commands: *const Commands) !void {
+        const frame = &self.frames[index];
+        if (frame.command_count != world.counters.frame_commands_applied or frame.command_hash != commands.stream_hash) {
+            std.log.err("Replay diverged in frame {}: {} commands (hash {x}), recorded {} commands (hash {x})", .{
+                index,
+                world.counters.frame_commands_applied,
+                commands.stream_hash,
+                frame.command_count,
+                frame.command_hash,
+            });
+            return error.ReplayDiverged;
+        }
+    }
+};
+
+fn inputToFlags(input: Input) u8 {
+    return @as(u8, @boolToInt(input.left)) |
+        (@as(u8, @boolToInt(input.right)) << 1) |
+        (@as(u8, @boolToInt(input.up)) << 2) |
+        (@as(u8, @boolToInt(input.down)) << 3);
+}
+
+fn flagsToInput(flags: u8) Input {
+    return .{
+        .left = flags & 1 != 0,
+        .right = flags & (1 << 1) != 0,
+        .up = flags & (1 << 2) != 0,
+        .down = flags & (1 << 3) != 0,
+    };
+}
+
+/// Writes structs field by field, so the format doesn't depend on the memory layout chosen by the compiler.
+fn writeValue(writer: anytype, value: anytype) !void {
+    const T = @TypeOf(value);
+    switch (@typeInfo(T)) {
+        .Struct => |info| {
+            inline for (info.fields) |field| {
+                try writeValue(writer, @field(value, field.name));
+            }
+        },
+        .Int => try writer.writeIntLittle(T, value),
+        .Float => {
+            const Bits = std.meta.Int(.unsigned, @bitSizeOf(T));
+            try writer.writeIntLittle(Bits, @bitCast(Bits, value));
+        },
+        .Bool => try writer.writeByte(@boolToInt(value)),
+        else => @compileError("Can't write values of type " ++ @typeName(T) ++ " to a replay"),
+    }
+}
+
+fn readValue(comptime T: type, reader: anytype) !T {
+    switch (@typeInfo(T)) {
+        .Struct => |info| {
+            var result: T = undefined;
+            inline for (info.fields) |field| {
+                @field(result, field.name) = try readValue(field.field_type, reader);
+            }
+            return result;
+        },
+        .Int => return try reader.readIntLittle(T),
+        .Float => {
+            const Bits = std.meta.Int(.unsigned, @bitSizeOf(T));
+            return @bitCast(T, try reader.readIntLittle(Bits));
+        },
+        .Bool => return (try reader.readByte()) != 0,
+        else => @compileError("Can't read values of type " ++ @typeName(T) ++ " from a replay"),
+    }
+}
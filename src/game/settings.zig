@@ -0,0 +1,56 @@
+//! Tweakable values of the game systems.
+//! Every world has its own `GameSettings` resource instead of static variables, so worlds can run in parallel.
+//! The editor shows them in the "Variables" window.
+
+pub const BibleSettings = struct {
+    base_range: f32 = 75,
+    max_age: f32 = 3000,
+    cooldown: f32 = 5,
+    amount: i32 = 2,
+    speed: f32 = 50,
+    damage: f32 = 0.5,
+    push_amount: f32 = 100,
+};
+
+pub const AxeSettings = struct {
+    base_area: f32 = 1,
+    max_age: f32 = 3,
+    cooldown: f32 = 3,
+    amount: i32 = 0,
+    speed: f32 = 200,
+    damage: f32 = 11,
+    gravity: f32 = -300,
+    rotation_speed: f32 = 360,
+    direction_deviation: f32 = 0.2,
+    player_velocity_factor: f32 = 0.4,
+};
+
+pub const GemSettings = struct {
+    attract_area: f32 = 100,
+    radius: f32 = 20,
+    xp_multiplier: f32 = 1,
+    speed: f32 = 350,
+};
+
+pub const EnemySettings = struct {
+    max_gem_count: u64 = 100,
+    spawn_distance: f32 = 200,
+    spawn_distance_width: f32 = 200,
+    desired_count: i32 = 10,
+    health: f32 = 10,
+    max_despawn_distance: f32 = 2000,
+    /// Entities further away from the camera than this times the camera size are updated at the lowest rate.
+    lod_far_distance_factor: f32 = 2,
+};
+
+pub const PhysicsSettings = struct {
+    solve_iterations: u64 = 1,
+};
+
+pub const GameSettings = struct {
+    bible: BibleSettings = .{},
+    axe: AxeSettings = .{},
+    gem: GemSettings = .{},
+    enemies: EnemySettings = .{},
+    physics: PhysicsSettings = .{},
+};
@@ -0,0 +1,31 @@
+//! Registers the systems which make up the game simulation, so every executable runs the same systems in the same order.
+//! Editor and rendering systems are added by the executables themselves.
+
+const World = @import("../ecs/world.zig");
+
+const enemies = @import("enemies.zig");
+const gem = @import("gem.zig");
+const physics = @import("physics.zig");
+const player = @import("player.zig");
+const rendering = @import("rendering.zig");
+const axe = @import("weapons/axe.zig");
+const bible = @import("weapons/bible.zig");
+
+/// Expects the resources `Time`, `Input`, `GameSettings`, `LodScheduler`, `Commands`, `AssetDB`, `PhysicsScene`,
+/// `BibleResource`, `AxeResource` and `EnemySpawner`.
+pub fn addSimulationSystems(world: *World) !void {
+    try world.addSystemToStage(.PreUpdate, enemies.lodBucketSystem, "LOD buckets");
+
+    try world.addSystem(player.moveSystemPlayer, "Move System Player");
+    // Nothing to move and no gems to spawn without enemies or gems.
+    try world.addSystemWithCriteria(.Update, enemies.moveSystemFollowPlayer, "Move System Follow Player", .{ .skip_if_queries_empty = true });
+    try world.addSystemWithCriteria(.Update, enemies.despawnSystemFollowPlayer, "Despawn Follow Player", .{ .skip_if_queries_empty = true });
+    try world.addSystem(bible.bibleSystem, "Bible");
+    try world.addSystem(axe.axeSystem, "Axe");
+    try world.addSystem(enemies.enemySpawnSystem, "Enemy spawning");
+    try world.addSystemWithCriteria(.Update, gem.gemSystem, "Gem spawning", .{ .skip_if_queries_empty = true });
+    try world.addSystem(rendering.spriteAnimationSystem, "Sprite animation");
+
+    // After the Update flush, so projectiles spawned this frame already collide.
+    try world.addSystemToStage(.PostUpdate, physics.physicsSystem, "Physics");
+}
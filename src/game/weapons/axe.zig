@@ -1,7 +1,5 @@
 const std = @import("std");
 
-const imgui2 = @import("../../editor/imgui2.zig");
-
 const math = @import("../../math.zig");
 const Vec2 = math.Vec2;
 const Vec3 = math.Vec3;
@@ -19,7 +17,9 @@ const Profiler = @import("../../editor/profiler.zig");
 const EntityId = @import("../../ecs/entity.zig").EntityId;
 const World = @import("../../ecs/world.zig");
 const Query = @import("../../ecs/query.zig").Query;
+const Single = @import("../../ecs/query.zig").Single;
 const Commands = @import("../../ecs/commands.zig");
+const EntityPool = @import("../../ecs/entity_pool.zig");
 
 const basic_components = @import("../basic_components.zig");
 const Time = basic_components.Time;
@@ -27,41 +27,32 @@ const TransformComponent = basic_components.TransformComponent;
 const SpeedComponent = basic_components.SpeedComponent;
 const SpriteComponent = basic_components.SpriteComponent;
 const Player = @import("../player.zig").Player;
+const GameSettings = @import("../settings.zig").GameSettings;
 const PhysicsComponent = @import("../physics.zig").PhysicsComponent;
 const HealthComponent = basic_components.HealthComponent;
 
 pub const AxeResource = struct {
-    entity_ids: std.ArrayList(EntityId),
+    /// Expired axes are parked here and reused by `createAxe`.
+    pool: EntityPool,
     world: *World,
     prng: std.rand.DefaultPrng,
+    last_spawn_time: f32 = 0,
 
     pub fn init(allocator: std.mem.Allocator, world: *World) @This() {
         return @This(){
-            .entity_ids = std.ArrayList(EntityId).init(allocator),
+            .pool = EntityPool.init(allocator),
             .world = world,
             .prng = std.rand.DefaultPrng.init(123),
         };
     }
 
     pub fn deinit(self: *const @This()) void {
-        self.entity_ids.deinit();
+        self.pool.deinit();
     }
 
     pub fn rand(self: *@This()) std.rand.Random {
         return self.prng.random();
     }
-
-    pub fn getFreeEntityId(self: *@This()) EntityId {
-        if (self.entity_ids.items.len > 0) {
-            return self.entity_ids.pop();
-        } else {
-            return self.world.reserveEntityId();
-        }
-    }
-
-    pub fn returnEntityId(self: *@This(), entity_id: EntityId) !void {
-        try self.entity_ids.append(entity_id);
-    }
 };
 
 pub const AxeComponent = struct {
@@ -69,8 +60,7 @@ pub const AxeComponent = struct {
     velocity: Vec3 = Vec3.zero(),
 };
 
-pub fn createAxe(commands: *Commands, assetdb: *AssetDB, axe_res: *AxeResource, position: Vec3, velocity: Vec3) !void {
-    _ = axe_res;
+pub fn createAxe(commands: *Commands, assetdb: *const AssetDB, axe_res: *AxeResource, position: Vec3, velocity: Vec3) !void {
     var entity = .{
         .axe = AxeComponent{},
         .transform = TransformComponent{},
@@ -81,47 +71,32 @@ pub fn createAxe(commands: *Commands, assetdb: *AssetDB, axe_res: *AxeResource,
     };
     entity.axe.velocity = velocity;
     entity.transform.position = position;
-    entity.sprite.texture = try assetdb.getTextureByPath("Axe.png", .{});
-    _ = try commands.createEntityBundle(&entity);
+    entity.sprite.texture = assetdb.findTextureByPath("Axe.png") orelse return error.TextureNotLoaded;
+    _ = try axe_res.pool.spawn(axe_res.world, commands, &entity);
 }
 
 pub fn axeSystem(
     time: *const Time,
     commands: *Commands,
-    assetdb: *AssetDB,
+    assetdb: *const AssetDB,
+    settings: *const GameSettings,
     axe_res: *AxeResource,
-    player_query: Query(.{ Player, TransformComponent }),
+    player_single: Single(.{ Player, TransformComponent }),
     query: Query(.{ AxeComponent, TransformComponent, PhysicsComponent }),
 ) !void {
-    const player = player_query.iter().next() orelse {
-        std.log.err("axeSystem: No player found.", .{});
-        return;
-    };
-
-    const base_area = imgui2.variable(axeSystem, f32, "Axe base area", 1, true, .{ .min = 1, .speed = 0.1 }).*;
-    const area = base_area * player.player.area_modifier;
-
-    const base_max_age = imgui2.variable(axeSystem, f32, "Axe max age", 3, true, .{ .min = 1, .speed = 0.1 }).*;
-    const max_age = base_max_age * player.player.duration_modifier;
-
-    const base_cooldown = imgui2.variable(axeSystem, f32, "Axe cooldown", 3, true, .{ .min = 0.1 }).*;
-    const cooldown = base_cooldown * player.player.cooldown_modifier;
-
-    const base_amount = imgui2.variable(axeSystem, i32, "Axe amount", 0, true, .{ .min = 1 }).*;
-    const amount = base_amount + player.player.amount_modifier;
-
-    const base_speed = imgui2.variable(axeSystem, f32, "Axe speed", 200, true, .{ .min = 1 }).*;
-    const speed = base_speed * player.player.speed_modifier;
-
-    const base_damage = imgui2.variable(axeSystem, f32, "Axe damage", 11, true, .{ .min = 0, .speed = 0.1 }).*;
-    const damage = base_damage * player.player.damage_modifier;
+    const player = player_single.get();
 
-    var last_spawn_time = imgui2.variable(axeSystem, f32, "last_spawn_time", 0, false, .{ .min = 5 });
+    const area = settings.axe.base_area * player.player.area_modifier;
+    const max_age = settings.axe.max_age * player.player.duration_modifier;
+    const cooldown = settings.axe.cooldown * player.player.cooldown_modifier;
+    const amount = settings.axe.amount + player.player.amount_modifier;
+    const speed = settings.axe.speed * player.player.speed_modifier;
+    const damage = settings.axe.damage * player.player.damage_modifier;
 
-    var gravity = imgui2.variable(axeSystem, f32, "Ave gravity", -300, true, .{ .speed = 0.1 }).*;
-    var rotation_speed = imgui2.variable(axeSystem, f32, "Axe rotation speed", 360, true, .{ .speed = 0.1 }).*;
-    var dir_stddev = imgui2.variable(axeSystem, f32, "Axe direction deviation", 0.2, true, .{ .speed = 0.1 }).*;
-    var player_velocity_factor = imgui2.variable(axeSystem, f32, "Axe player velocity factor", 0.4, true, .{ .speed = 0.1 }).*;
+    const gravity = settings.axe.gravity;
+    const rotation_speed = settings.axe.rotation_speed;
+    const dir_stddev = settings.axe.direction_deviation;
+    const player_velocity_factor = settings.axe.player_velocity_factor;
 
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
@@ -139,8 +114,7 @@ pub fn axeSystem(
         entity.axe.age += delta;
 
         if (entity.axe.age > max_age) {
-            try commands.destroyEntity(entity.ref.*);
-            try axe_res.returnEntityId(entity.ref.id);
+            try axe_res.pool.park(commands, entity.ref.*);
         }
 
         for (entity.physics.colliding_entities_new) |e| {
@@ -153,8 +127,8 @@ pub fn axeSystem(
     }
 
     // Spawn new axes.
-    if ((@floatCast(f32, time.now) - last_spawn_time.*) > cooldown) {
-        last_spawn_time.* = @floatCast(f32, time.now);
+    if ((@floatCast(f32, time.now) - axe_res.last_spawn_time) > cooldown) {
+        axe_res.last_spawn_time = @floatCast(f32, time.now);
 
         var rand = axe_res.rand();
 
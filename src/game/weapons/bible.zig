@@ -1,7 +1,5 @@
 const std = @import("std");
 
-const imgui2 = @import("../../editor/imgui2.zig");
-
 const math = @import("../../math.zig");
 const Vec2 = math.Vec2;
 const Vec3 = math.Vec3;
@@ -19,7 +17,9 @@ const Profiler = @import("../../editor/profiler.zig");
 const EntityId = @import("../../ecs/entity.zig").EntityId;
 const World = @import("../../ecs/world.zig");
 const Query = @import("../../ecs/query.zig").Query;
+const Single = @import("../../ecs/query.zig").Single;
 const Commands = @import("../../ecs/commands.zig");
+const EntityPool = @import("../../ecs/entity_pool.zig");
 
 const basic_components = @import("../basic_components.zig");
 const Time = basic_components.Time;
@@ -29,32 +29,23 @@ const SpriteComponent = basic_components.SpriteComponent;
 const Player = @import("../player.zig").Player;
 const PhysicsComponent = @import("../physics.zig").PhysicsComponent;
 const HealthComponent = basic_components.HealthComponent;
+const GameSettings = @import("../settings.zig").GameSettings;
 
 pub const BibleResource = struct {
-    entity_ids: std.ArrayList(EntityId),
+    /// Expired bibles are parked here and reused by `createBible`.
+    pool: EntityPool,
     world: *World,
+    last_spawn_time: f32 = 0,
 
     pub fn init(allocator: std.mem.Allocator, world: *World) @This() {
         return @This(){
-            .entity_ids = std.ArrayList(EntityId).init(allocator),
+            .pool = EntityPool.init(allocator),
             .world = world,
         };
     }
 
     pub fn deinit(self: *const @This()) void {
-        self.entity_ids.deinit();
-    }
-
-    pub fn getFreeEntityId(self: *@This()) EntityId {
-        if (self.entity_ids.items.len > 0) {
-            return self.entity_ids.pop();
-        } else {
-            return self.world.reserveEntityId();
-        }
-    }
-
-    pub fn returnEntityId(self: *@This(), entity_id: EntityId) !void {
-        try self.entity_ids.append(entity_id);
+        self.pool.deinit();
     }
 };
 
@@ -62,8 +53,7 @@ pub const BibleComponent = struct {
     age: f32 = 0,
 };
 
-pub fn createBible(commands: *Commands, assetdb: *AssetDB, bible_res: *BibleResource) !void {
-    _ = bible_res;
+pub fn createBible(commands: *Commands, assetdb: *const AssetDB, bible_res: *BibleResource) !void {
     var entity = .{
         .axe = BibleComponent{},
         .transform = TransformComponent{},
@@ -71,44 +61,28 @@ pub fn createBible(commands: *Commands, assetdb: *AssetDB, bible_res: *BibleReso
         .health = HealthComponent{},
         .sprite = SpriteComponent{ .texture = undefined },
     };
-    entity.sprite.texture = try assetdb.getTextureByPath("HolyBook.png", .{});
-    _ = try commands.createEntityBundle(&entity);
+    entity.sprite.texture = assetdb.findTextureByPath("HolyBook.png") orelse return error.TextureNotLoaded;
+    _ = try bible_res.pool.spawn(bible_res.world, commands, &entity);
 }
 
 pub fn bibleSystem(
     time: *const Time,
     commands: *Commands,
-    assetdb: *AssetDB,
+    assetdb: *const AssetDB,
+    settings: *const GameSettings,
     bible_res: *BibleResource,
-    player_query: Query(.{ Player, TransformComponent }),
+    player_single: Single(.{ Player, TransformComponent }),
     query: Query(.{ BibleComponent, TransformComponent, PhysicsComponent }),
 ) !void {
-    const player = player_query.iter().next() orelse {
-        std.log.err("bibleSystem: No player found.", .{});
-        return;
-    };
-
-    const base_range = imgui2.variable(bibleSystem, f32, "Bible base range", 75, true, .{ .min = 5 }).*;
-    const range = base_range * player.player.area_modifier;
-
-    const base_max_age = imgui2.variable(bibleSystem, f32, "Bible max age", 3000, true, .{ .min = 1 }).*;
-    const max_age = base_max_age * player.player.duration_modifier;
-
-    const base_cooldown = imgui2.variable(bibleSystem, f32, "Bible cooldown", 5, true, .{ .min = 1 }).*;
-    const cooldown = base_cooldown * player.player.cooldown_modifier;
-
-    const base_amount = imgui2.variable(bibleSystem, i32, "Bible amount", 2, true, .{ .min = 1 }).*;
-    const amount = base_amount + player.player.amount_modifier;
-
-    const base_speed = imgui2.variable(bibleSystem, f32, "Bible speed", 50, true, .{ .min = 1 }).*;
-    const speed = base_speed * player.player.speed_modifier;
-
-    const base_damage = imgui2.variable(bibleSystem, f32, "Bible damage", 0.5, true, .{ .min = 0, .speed = 0.1 }).*;
-    const damage = base_damage * player.player.damage_modifier;
-
-    const push_amount = imgui2.variable(bibleSystem, f32, "Bible push amount", 100, true, .{ .min = 0, .speed = 0.1 }).*;
+    const player = player_single.get();
 
-    var last_spawn_time = imgui2.variable(bibleSystem, f32, "last_spawn_time", 0, false, .{ .min = 5 });
+    const range = settings.bible.base_range * player.player.area_modifier;
+    const max_age = settings.bible.max_age * player.player.duration_modifier;
+    const cooldown = settings.bible.cooldown * player.player.cooldown_modifier;
+    const amount = settings.bible.amount + player.player.amount_modifier;
+    const speed = settings.bible.speed * player.player.speed_modifier;
+    const damage = settings.bible.damage * player.player.damage_modifier;
+    const push_amount = settings.bible.push_amount;
 
     const delta = @floatCast(f32, time.delta);
     if (delta == 0)
@@ -132,8 +106,7 @@ pub fn bibleSystem(
         i += 1;
 
         if (entity.bible.age > max_age) {
-            try commands.destroyEntity(entity.ref.*);
-            try bible_res.returnEntityId(entity.ref.id);
+            try bible_res.pool.park(commands, entity.ref.*);
         }
 
         for (entity.physics.colliding_entities_new) |e| {
@@ -150,8 +123,8 @@ pub fn bibleSystem(
     }
 
     // Spawn new bibles.
-    if (bible_count == 0 and (@floatCast(f32, time.now) - last_spawn_time.*) > cooldown) {
-        last_spawn_time.* = @floatCast(f32, time.now);
+    if (bible_count == 0 and (@floatCast(f32, time.now) - bible_res.last_spawn_time) > cooldown) {
+        bible_res.last_spawn_time = @floatCast(f32, time.now);
         var k: i32 = 0;
         while (k < amount) : (k += 1) {
             try createBible(commands, assetdb, bible_res);
@@ -0,0 +1,262 @@
+//! Runs the game simulation without window, renderer, editor or assets, for measuring simulation throughput.
+//! Input comes from a script and every frame uses the same fixed delta time.
+//!
+//! Usage: zentt-headless [--enemies N] [--frames N] [--delta SECONDS] [--input SCRIPT] [--report-interval N]
+//!                       [--record REPLAY] [--replay REPLAY]
+//!
+//! An input script has one line per change of the input: `<frame> <keys>`, where keys is any combination
+//! of `l`, `r`, `u` and `d`, or `-` for no key. The input stays the same until the next line, lines starting with `#` are ignored.
+//! Without a script the player walks in a square.
+//!
+//! `--record` writes the session to a replay file, see `game/replay.zig`. `--replay` runs a recorded session instead,
+//! taking input, delta times and settings from the file and failing if the simulation diverges from the recording.
+
+const std = @import("std");
+
+const math = @import("math.zig");
+const Vec3 = math.Vec3;
+
+const AssetDB = @import("rendering/assetdb.zig");
+const World = @import("ecs/world.zig");
+const Commands = @import("ecs/commands.zig");
+const LodScheduler = @import("ecs/lod_scheduler.zig");
+
+const assets = @import("assets.zig");
+const game = @import("game/game.zig");
+
+const InputStep = struct {
+    frame: u64,
+    input: game.Input,
+};
+
+const default_input_script = [_]InputStep{
+    .{ .frame = 0, .input = .{ .right = true } },
+    .{ .frame = 120, .input = .{ .up = true } },
+    .{ .frame = 240, .input = .{ .left = true } },
+    .{ .frame = 360, .input = .{ .down = true } },
+};
+const default_input_script_length = 480;
+
+const Options = struct {
+    enemies: i32 = 10_000,
+    frames: u64 = 1000,
+    delta: f64 = 1.0 / 60.0,
+    input_script_path: ?[]const u8 = null,
+    report_interval: u64 = 100,
+    record_path: ?[]const u8 = null,
+    replay_path: ?[]const u8 = null,
+};
+
+fn parseOptions(args: []const [:0]u8) !Options {
+    var options = Options{};
+
+    var i: usize = 1;
+    while (i < args.len) : (i += 1) {
+        const arg = args[i];
+        if (i + 1 >= args.len) {
+            std.log.err("Missing value for argument '{s}'", .{arg});
+            return error.InvalidArguments;
+        }
+        const value = args[i + 1];
+        i += 1;
+
+        if (std.mem.eql(u8, arg, "--enemies")) {
+            options.enemies = try std.fmt.parseInt(i32, value, 10);
+        } else if (std.mem.eql(u8, arg, "--frames")) {
+            options.frames = try std.fmt.parseInt(u64, value, 10);
+        } else if (std.mem.eql(u8, arg, "--delta")) {
+            options.delta = try std.fmt.parseFloat(f64, value);
+        } else if (std.mem.eql(u8, arg, "--input")) {
+            options.input_script_path = value;
+        } else if (std.mem.eql(u8, arg, "--report-interval")) {
+            options.report_interval = try std.fmt.parseInt(u64, value, 10);
+        } else if (std.mem.eql(u8, arg, "--record")) {
+            options.record_path = value;
+        } else if (std.mem.eql(u8, arg, "--replay")) {
+            options.replay_path = value;
+        } else {
+            std.log.err("Unknown argument '{s}'", .{arg});
+            return error.InvalidArguments;
+        }
+    }
+
+    return options;
+}
+
+fn parseInputScript(allocator: std.mem.Allocator, text: []const u8) ![]InputStep {
+    var steps = std.ArrayList(InputStep).init(allocator);
+    errdefer steps.deinit();
+
+    var lines = std.mem.tokenize(u8, text, "\r\n");
+    while (lines.next()) |line| {
+        if (line.len == 0 or line[0] == '#')
+            continue;
+
+        var parts = std.mem.tokenize(u8, line, " \t");
+        const frame = parts.next() orelse continue;
+        const keys = parts.next() orelse return error.InvalidInputScript;
+
+        var step = InputStep{ .frame = try std.fmt.parseInt(u64, frame, 10), .input = .{} };
+        for (keys) |key| {
+            switch (key) {
+                'l' => step.input.left = true,
+                'r' => step.input.right = true,
+                'u' => step.input.up = true,
+                'd' => step.input.down = true,
+                '-' => {},
+                else => return error.InvalidInputScript,
+            }
+        }
+
+        if (steps.items.len > 0 and steps.items[steps.items.len - 1].frame > step.frame) {
+            return error.InputScriptNotSorted;
+        }
+        try steps.append(step);
+    }
+
+    return steps.toOwnedSlice();
+}
+
+/// Returns the input of the last step at or before `frame`.
+fn inputAtFrame(steps: []const InputStep, frame: u64) game.Input {
+    var result = game.Input{};
+    for (steps) |step| {
+        if (step.frame > frame)
+            break;
+        result = step.input;
+    }
+    return result;
+}
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+    var options = try parseOptions(args);
+
+    var input_script: ?[]InputStep = null;
+    defer if (input_script) |script| allocator.free(script);
+    if (options.input_script_path) |path| {
+        const text = try std.fs.cwd().readFileAlloc(allocator, path, std.math.maxInt(u32));
+        defer allocator.free(text);
+        input_script = try parseInputScript(allocator, text);
+    }
+
+    var replay: ?game.Replay = null;
+    defer if (replay) |*r| r.deinit();
+    if (options.replay_path) |path| {
+        replay = try game.Replay.load(allocator, path);
+        options.frames = replay.?.frames.len;
+    }
+
+    var world = try World.init(allocator);
+    defer world.deinit();
+    try game.addSimulationSystems(world);
+
+    var time = try world.addResource(game.Time{});
+    var settings = try world.addResource(game.GameSettings{});
+    settings.enemies.desired_count = options.enemies;
+    var lod_scheduler = try world.addResource(LodScheduler{});
+    var input = try world.addResource(game.Input{});
+
+    var commands = try world.addResource(Commands.init(allocator, world));
+    defer commands.deinit();
+
+    var assetdb = try world.addResource(AssetDB.initWithoutGpu(allocator));
+    defer assetdb.deinit();
+    try assets.loadPlaceholderAssets(assetdb);
+
+    var physics_scene = try world.addResource(try game.PhysicsScene.init(allocator, world));
+    defer physics_scene.deinit();
+
+    var bible_res = try world.addResource(game.BibleResource.init(allocator, world));
+    defer bible_res.deinit();
+
+    var axe_res = try world.addResource(game.AxeResource.init(allocator, world));
+    defer axe_res.deinit();
+
+    var enemy_spawner = try world.addResource(game.EnemySpawner.init(allocator, world));
+    defer enemy_spawner.deinit();
+
+    try game.createPlayer(commands, assetdb, comptime Vec3.new(100, 0, 0));
+    try commands.applyCommands();
+
+    var recorder: ?game.ReplayRecorder = null;
+    defer if (recorder) |*r| r.deinit();
+    if (options.record_path) |path| {
+        recorder = try game.ReplayRecorder.init(path, world, commands, time);
+    }
+
+    if (replay) |*r| {
+        try r.begin(world, commands, time);
+        std.debug.print("Replaying {} frames from {s}\n", .{ options.frames, options.replay_path.? });
+    } else {
+        std.debug.print("Simulating {} frames with {} enemies, delta {d:.4}s\n", .{ options.frames, options.enemies, options.delta });
+    }
+
+    var total_time_ns: u64 = 0;
+    var total_entity_frames: u64 = 0;
+    var interval_time_ns: u64 = 0;
+    var timer = try std.time.Timer.start();
+
+    var frame: u64 = 0;
+    while (frame < options.frames) : (frame += 1) {
+        if (replay) |*r| {
+            r.applyFrame(@intCast(usize, frame), input, time, settings);
+        } else {
+            input.* = if (input_script) |script| inputAtFrame(script, frame) else inputAtFrame(&default_input_script, frame % default_input_script_length);
+            time.delta = options.delta;
+            time.now += options.delta;
+        }
+        lod_scheduler.update(@floatCast(f32, time.delta));
+
+        timer.reset();
+        try world.runFrameSystems();
+        try commands.applyCommands();
+        const frame_time_ns = timer.read();
+
+        if (recorder) |*r| {
+            try r.recordFrame(world, commands, input.*, time.*, settings.*);
+        }
+        if (replay) |*r| {
+            try r.verifyFrame(@intCast(usize, frame), world, commands);
+        }
+        world.endFrame();
+
+        total_time_ns += frame_time_ns;
+        interval_time_ns += frame_time_ns;
+        total_entity_frames += world.getEntityCount();
+
+        if (options.report_interval > 0 and (frame + 1) % options.report_interval == 0) {
+            std.debug.print("  frame {}: {} entities, {d:.3}ms/frame\n", .{
+                frame + 1,
+                world.getEntityCount(),
+                @intToFloat(f64, interval_time_ns) / @intToFloat(f64, options.report_interval) / std.time.ns_per_ms,
+            });
+            interval_time_ns = 0;
+        }
+    }
+
+    const total_time_s = @intToFloat(f64, total_time_ns) / std.time.ns_per_s;
+    std.debug.print("Total: {d:.3}s, {d:.3}ms/frame, {d:.2}M entity updates/s\n", .{
+        total_time_s,
+        total_time_s * std.time.ms_per_s / @intToFloat(f64, std.math.max(options.frames, 1)),
+        @intToFloat(f64, total_entity_frames) / std.math.max(total_time_s, 1e-9) / 1_000_000,
+    });
+
+    std.debug.print("Systems (average ms per run):\n", .{});
+    for (world.stages) |*stage| {
+        for (stage.systems.items) |*system| {
+            const runs = std.math.max(system.counters.runs, 1);
+            std.debug.print("  {s}: {d:.3}ms, {} runs, {} skipped\n", .{
+                system.name,
+                @intToFloat(f64, system.counters.total_time_ns) / @intToFloat(f64, runs) / std.time.ns_per_ms,
+                system.counters.runs,
+                system.counters.skipped,
+            });
+        }
+    }
+}
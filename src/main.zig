@@ -32,6 +32,8 @@ const EntityBuilder = @import("ecs/entity_builder.zig");
 const Query = @import("ecs/query.zig").Query;
 const Tag = @import("ecs/tag_component.zig").Tag;
 const Commands = @import("ecs/commands.zig");
+const LodScheduler = @import("ecs/lod_scheduler.zig");
+const RenderThread = @import("ecs/render_thread.zig");
 
 const app_name = "vulkan-zig triangle example";
 
@@ -44,23 +46,26 @@ pub fn main() !void {
     defer _ = gpa.deinit();
     const allocator = gpa.allocator();
 
+    // `--record <path>` records the session, which can be replayed with the headless build.
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+    const record_path: ?[]const u8 = if (args.len >= 3 and std.mem.eql(u8, args[1], "--record")) args[2] else null;
+
     var app = try App.init(allocator);
     defer app.deinit();
 
     var world = try World.init(allocator);
     defer world.deinit();
     defer world.dumpGraph() catch {};
-    try world.addSystem(game.moveSystemPlayer, "Move System Player");
-    try world.addSystem(game.moveSystemFollowPlayer, "Move System Follow Player");
-    try world.addSystem(game.bibleSystem, "Bible");
-    try world.addSystem(game.axeSystem, "Axe");
-    try world.addSystem(game.enemySpawnSystem, "Enemy spawning");
-    try world.addSystem(game.gemSystem, "Gem spawning");
-    try world.addSystem(game.physicsSystem, "Physics");
+    try game.addSimulationSystems(world);
+    try world.addSystemToStage(.PostUpdate, game.physicsDebugSystem, "Physics debug");
+    try world.addSystemToStage(.Extract, game.spriteExtractSystem, "Sprite extraction");
 
     try world.addRenderSystem(game.spriteRenderSystem, "Render System Vulkan");
 
-    _ = try world.addResource(game.Time{});
+    var time = try world.addResource(game.Time{});
+    var settings = try world.addResource(game.GameSettings{});
+    var lod_scheduler = try world.addResource(LodScheduler{});
     var commands = try world.addResource(Commands.init(allocator, world));
     defer commands.deinit();
 
@@ -72,6 +77,9 @@ pub fn main() !void {
     var physics_scene = try world.addResource(try game.PhysicsScene.init(allocator, world));
     defer physics_scene.deinit();
 
+    var render_extraction = try world.addResource(game.RenderExtraction.init(allocator));
+    defer render_extraction.deinit();
+
     try assets.loadAssets(assetdb);
 
     var profiler = app.profiler;
@@ -89,25 +97,7 @@ pub fn main() !void {
     var enemy_spawner = try world.addResource(game.EnemySpawner.init(allocator, world));
     defer enemy_spawner.deinit();
 
-    var player = .{
-        .player = game.Player{
-            .area_modifier = 1,
-            .speed_modifier = 1,
-            .duration_modifier = 1,
-            .damage_modifier = 1,
-            .cooldown_modifier = 1,
-            .amount_modifier = 0,
-        },
-        .transform = game.TransformComponent{ .position = comptime Vec3.new(100, 0, 0), .size = 1 },
-        .speed = game.SpeedComponent{ .speed = 150 },
-        .camera = game.CameraComponent{ .size = 1000 },
-        .physics = game.PhysicsComponent{ .own_layer = 0b0001, .target_layer = 0b0010, .radius = 15, .inverse_mass = 0 },
-        .health = game.HealthComponent{ .health = 100 },
-        .grid_center = game.GridCenterComponent{},
-        .sprite = game.AnimatedSpriteComponent{ .anim = undefined },
-    };
-    player.sprite.anim = assetdb.getSpriteAnimation("Antonio") orelse unreachable;
-    _ = try commands.createEntityBundle(&player);
+    try game.createPlayer(commands, assetdb, comptime Vec3.new(100, 0, 0));
 
     // Background.
     var background = .{
@@ -161,6 +151,12 @@ pub fn main() !void {
 
     _ = try commands.applyCommands();
 
+    var recorder: ?game.ReplayRecorder = null;
+    defer if (recorder) |*r| r.deinit();
+    if (record_path) |path| {
+        recorder = try game.ReplayRecorder.init(path, world, commands, time);
+    }
+
     var details = Details.init(allocator);
     defer details.deinit();
     try details.registerDefaultComponent(game.Player{});
@@ -180,6 +176,12 @@ pub fn main() !void {
     var lastFrameTime = std.time.nanoTimestamp();
     var frameTimeSmoothed: f64 = 0;
 
+    // Records the render snapshot of the last frame on another thread while the current frame is simulated,
+    // so a frame takes max(simulation, render) instead of their sum, at the cost of one frame of latency.
+    var pipelined = true;
+    var render_thread = try RenderThread.init(allocator, world);
+    defer render_thread.deinit();
+
     defer app.waitIdle();
     while (app.isRunning) {
         var event: sdl.SDL_Event = undefined;
@@ -223,6 +225,7 @@ pub fn main() !void {
         var timeResource = try world.getResource(game.Time);
         timeResource.delta = @intToFloat(f64, frameTimeNs) / std.time.ns_per_s;
         timeResource.now += timeResource.delta;
+        lod_scheduler.update(@floatCast(f32, timeResource.delta));
 
         var b = true;
         imgui2.showDemoWindow(&b);
@@ -231,6 +234,7 @@ pub fn main() !void {
             imgui.LabelText("Frame time: ", "%.2f", frameTimeSmoothed);
             imgui.LabelText("FPS: ", "%.1f", fps);
             imgui.LabelText("Entities: ", "%lld", world.getEntityCount());
+            _ = imgui.Checkbox("Pipelined rendering", &pipelined);
         }
         imgui.End();
 
@@ -288,37 +292,70 @@ pub fn main() !void {
             imgui.End();
         }
 
+        if (imgui.Begin("Variables")) {
+            imgui2.any(settings, "Settings", .{});
+        }
+        imgui.End();
+
         try details.draw(world, selectedEntity, commands);
         try profiler.draw();
         try chunkDebugger.draw(world);
         try viewport.drawScene();
 
-        {
-            const scope = Profiler.beginScope("runFrameSystems");
+        if (pipelined) {
+            const scope = Profiler.beginScope("runFrameSystems pipelined");
             defer scope.end();
 
+            // Renders the snapshot extracted in the last frame.
+            try app.beginRender(viewport.content_size);
+            render_thread.start();
+
             world.runFrameSystems() catch |err| {
                 std.log.err("Failed to run frame systems: {}", .{err});
             };
-        }
 
-        {
-            const scope = Profiler.beginScope("runRenderSystems");
-            defer scope.end();
-
-            try app.beginRender(viewport.content_size);
-            world.runRenderSystems() catch |err| {
+            render_thread.wait() catch |err| {
                 std.log.err("Failed to run render systems: {}", .{err});
             };
             try app.endRender();
+            render_extraction.swap();
+        } else {
+            {
+                const scope = Profiler.beginScope("runFrameSystems");
+                defer scope.end();
+
+                world.runFrameSystems() catch |err| {
+                    std.log.err("Failed to run frame systems: {}", .{err});
+                };
+            }
+
+            render_extraction.swap();
+
+            {
+                const scope = Profiler.beginScope("runRenderSystems");
+                defer scope.end();
+
+                try app.beginRender(viewport.content_size);
+                runRenderSystems(world);
+                try app.endRender();
+            }
         }
 
+        try profiler.recordSystems(world);
+
         var viewport_click_location: ?Vec2 = try viewport.draw(selectedEntity);
 
         {
+            // Flushes everything recorded after the last flushing stage, including the editor windows.
             commands.applyCommands() catch |err| {
                 std.log.err("applyCommands failed: {}", .{err});
             };
+            if (recorder) |*r| {
+                r.recordFrame(world, commands, input.*, timeResource.*, settings.*) catch |err| {
+                    std.log.err("Failed to record frame: {}", .{err});
+                };
+            }
+            world.endFrame();
         }
 
         try app.endFrame();
@@ -333,3 +370,9 @@ pub fn main() !void {
         }
     }
 }
+
+fn runRenderSystems(world: *World) void {
+    world.runRenderSystems() catch |err| {
+        std.log.err("Failed to run render systems: {}", .{err});
+    };
+}
@@ -32,6 +32,8 @@ pub const TextureAsset = struct {
             uv: Vec4,
             size: Vec2,
         },
+        /// Texture without image data, only has a size. See `definePlaceholderTexture`.
+        placeholder: Vec2,
     },
 
     pub fn deinit(self: *@This(), gc: *GraphicsContext) void {
@@ -53,12 +55,15 @@ pub const TextureAsset = struct {
             .ref => |ref| {
                 return ref.asset.resolve();
             },
+            .placeholder => {
+                @panic("Placeholder textures can't be rendered");
+            },
         }
     }
 
     pub fn getUV(self: *@This()) Vec4 {
         switch (self.data) {
-            .image => |_| {
+            .image, .placeholder => {
                 return Vec4.new(0, 1, 1, 0);
             },
             .ref => |ref| {
@@ -75,6 +80,9 @@ pub const TextureAsset = struct {
             .ref => |ref| {
                 return ref.size;
             },
+            .placeholder => |size| {
+                return size;
+            },
         }
     }
 };
@@ -107,6 +115,18 @@ pub fn init(allocator: std.mem.Allocator, gc: *GraphicsContext) !Self {
     };
 }
 
+/// Asset database for running without a GPU, only placeholder assets can be defined.
+pub fn initWithoutGpu(allocator: std.mem.Allocator) Self {
+    return Self{
+        .allocator = allocator,
+        .arena = std.heap.ArenaAllocator.init(allocator),
+        .texture_ids = std.StringHashMap(TextureId).init(allocator),
+        .textures = std.ArrayList(*TextureAsset).init(allocator),
+        .sprite_animations = std.StringHashMap(*SpriteAnimationAsset).init(allocator),
+        .gc = undefined,
+    };
+}
+
 pub fn deinit(self: *Self) void {
     // Sprite animations
     var sprite_animation_iter = self.sprite_animations.valueIterator();
@@ -303,6 +323,14 @@ pub fn getTextureByPath(self: *Self, asset_path: []const u8, options: TextureOpt
     }
 }
 
+/// Only returns already loaded textures, so it can be used on an asset database shared between threads.
+pub fn findTextureByPath(self: *const Self, asset_path: []const u8) ?*TextureAsset {
+    const id = self.texture_ids.get(asset_path) orelse return null;
+    if (id >= self.textures.items.len)
+        return null;
+    return self.textures.items[id];
+}
+
 pub fn getTextureById(self: *Self, id: TextureId) !*TextureAsset {
     if (id >= self.textures.items.len)
         return error.InvalidTextureIdInMap;
@@ -338,6 +366,53 @@ pub fn defineSpriteAnimation(self: *Self, name: []const u8, length: f32, options
     return asset;
 }
 
+/// Defines a texture which only has a size, so game code can run without loading images.
+pub fn definePlaceholderTexture(self: *Self, asset_path: []const u8, size: Vec2) !*TextureAsset {
+    if (self.texture_ids.contains(asset_path)) {
+        std.log.err("definePlaceholderTexture({s}): Texture with that path already exists", .{asset_path});
+        return error.TextureAlreadyExists;
+    }
+
+    var asset = try self.allocator.create(TextureAsset);
+    errdefer self.allocator.destroy(asset);
+
+    const asset_path_c = try self.arena.allocator().dupeZ(u8, asset_path);
+    asset.* = TextureAsset{
+        .data = .{ .placeholder = size },
+        .path = asset_path_c,
+    };
+    const id = self.textures.items.len;
+    try self.textures.append(asset);
+    errdefer _ = self.textures.pop();
+    try self.texture_ids.put(asset_path_c, id);
+
+    return asset;
+}
+
+/// Defines an animation with a single placeholder texture of the same name, see `definePlaceholderTexture`.
+pub fn definePlaceholderSpriteAnimation(self: *Self, name: []const u8, length: f32, size: Vec2) !*SpriteAnimationAsset {
+    if (self.sprite_animations.contains(name)) {
+        std.log.err("definePlaceholderSpriteAnimation({s}): Animation with that name already exists", .{name});
+        return error.SpriteAnimationAlreadyExists;
+    }
+
+    var sprites = try self.arena.allocator().alloc(*TextureAsset, 1);
+    sprites[0] = try self.definePlaceholderTexture(name, size);
+
+    var asset = try self.allocator.create(SpriteAnimationAsset);
+    errdefer self.allocator.destroy(asset);
+
+    asset.* = SpriteAnimationAsset{
+        .name = name,
+        .sprites = sprites,
+        .length = length,
+    };
+
+    try self.sprite_animations.put(name, asset);
+
+    return asset;
+}
+
 fn isDigit(c: u8) bool {
     return c >= '0' and c <= '9';
 }
@@ -2,6 +2,8 @@ const std = @import("std");
 
 const Impl = std.bit_set.StaticBitSet(64);
 
+pub const capacity = Impl.bit_length;
+
 bitSet: Impl,
 
 const Self = @This();
@@ -4,6 +4,29 @@ pub fn typeId(comptime T: type) TypeId {
     return TypeId{ .typeInfo = typeInfo(T) };
 }
 
+const no_type_index = std.math.maxInt(u32);
+var next_type_index = std.atomic.Atomic(u32).init(0);
+
+/// Returns a small index which is unique for T within this process, so it can be used to index arrays
+/// instead of hashing type ids. Indices are handed out on first use, so they are dense but not stable between runs.
+pub fn typeIndex(comptime T: type) u32 {
+    const slot = &struct {
+        var index = std.atomic.Atomic(u32).init(no_type_index);
+    }.index;
+
+    const index = slot.load(.Acquire);
+    if (index != no_type_index) {
+        return index;
+    }
+
+    // Another thread might assign an index at the same time, in which case ours is just never used.
+    const new_index = next_type_index.fetchAdd(1, .Monotonic);
+    if (slot.compareAndSwap(no_type_index, new_index, .AcqRel, .Acquire)) |existing| {
+        return existing;
+    }
+    return new_index;
+}
+
 fn structFields(comptime T: type) []const TypeInfoKind.StructField {
     const ti = @typeInfo(T).Struct;
     var fields = &struct {
@@ -22,6 +45,35 @@ fn structFields(comptime T: type) []const TypeInfoKind.StructField {
     return fields;
 }
 
+/// Serializes building type infos in `typeInfo`, so worlds on different threads can look up types concurrently.
+/// Recursive, because building the info of a type builds the infos of its fields, pointees, etc.
+const BuildLock = struct {
+    var mutex: std.Thread.Mutex = .{};
+    var owner = std.atomic.Atomic(std.Thread.Id).init(0);
+    var depth: u32 = 0;
+
+    fn lock() void {
+        const id = std.Thread.getCurrentId();
+        if (owner.load(.Monotonic) == id) {
+            depth += 1;
+            return;
+        }
+        mutex.lock();
+        owner.store(id, .Monotonic);
+        depth = 1;
+    }
+
+    fn unlock() void {
+        depth -= 1;
+        if (depth == 0) {
+            owner.store(0, .Monotonic);
+            mutex.unlock();
+        }
+    }
+};
+
+/// Built on first use. `ready` is only set once the info is complete, so other threads either see the finished info
+/// or wait for the thread building it. A recursive lookup of a type which is still being built returns the same pointer.
 pub fn typeInfo(comptime T: type) *const TypeInfo {
     if (T == *anyopaque)
         return typeInfo(void);
@@ -30,17 +82,29 @@ pub fn typeInfo(comptime T: type) *const TypeInfo {
         return typeInfo(void);
     }
 
-    var result = &struct {
+    const Slot = struct {
+        var ready = std.atomic.Atomic(bool).init(false);
         var x: TypeInfo = .{
             .hash = 0,
+            .index = no_type_index,
             .name = @typeName(T),
             .size = @sizeOf(T),
             .alignment = if (T == void) 0 else @alignOf(T),
             .kind = .Void,
         };
-    }.x;
+    };
+    var result = &Slot.x;
 
+    if (Slot.ready.load(.Acquire)) {
+        return result;
+    }
+
+    BuildLock.lock();
+    defer BuildLock.unlock();
+
+    // Hash is set first, so a recursive lookup of T while building doesn't build it again.
     if (result.hash == 0) {
+        result.index = typeIndex(T);
         result.hash = std.hash.Wyhash.hash(69, @typeName(T));
 
         switch (@typeInfo(T)) {
@@ -175,6 +239,8 @@ pub fn typeInfo(comptime T: type) *const TypeInfo {
                 result.kind = .EnumLiteral;
             },
         }
+
+        Slot.ready.store(true, .Release);
     }
 
     return result;
@@ -416,6 +482,8 @@ pub const TypeInfo = struct {
     const Self = @This();
 
     hash: u64,
+    /// See `typeIndex`.
+    index: u32,
     name: []const u8,
     size: u32,
     alignment: u32,
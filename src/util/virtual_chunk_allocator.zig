@@ -0,0 +1,126 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const mem = std.mem;
+const os = std.os;
+const Allocator = std.mem.Allocator;
+
+/// This allocator reserves one large range of virtual memory up front and hands out blocks from it
+/// with a bump pointer. Pages are only committed when the bump pointer reaches them, in steps of
+/// `commit_granularity`, and on Linux the whole range is marked for transparent huge pages.
+/// Individual frees only rewind the bump pointer if they free the latest allocation, everything else
+/// is returned to the OS in deinit. This fits chunks, which live as long as their world.
+/// Falls back to the child allocator when no virtual memory could be reserved or the range is exhausted.
+pub const VirtualChunkAllocator = struct {
+    pub const default_reserve_size: usize = 16 << 30;
+    const commit_granularity: usize = 2 << 20;
+    const supported = builtin.os.tag == .linux;
+
+    child_allocator: Allocator,
+    reserved: ?[]align(mem.page_size) u8 = null,
+    committed: usize = 0,
+    end_index: usize = 0,
+
+    pub fn init(child_allocator: Allocator, reserve_size: usize) VirtualChunkAllocator {
+        var self = VirtualChunkAllocator{ .child_allocator = child_allocator };
+
+        if (comptime supported) {
+            const size = mem.alignForward(reserve_size, commit_granularity);
+            // mmap only aligns to pages. Reserve one commit step more and cut the range down to a 2 MiB aligned one,
+            // so every committed step covers a whole huge page frame.
+            if (os.mmap(null, size + commit_granularity, os.PROT.NONE, os.MAP.PRIVATE | os.MAP.ANONYMOUS | os.MAP.NORESERVE, -1, 0)) |unaligned| {
+                const start = mem.alignForward(@ptrToInt(unaligned.ptr), commit_granularity) - @ptrToInt(unaligned.ptr);
+                const reserved = @alignCast(mem.page_size, unaligned[start .. start + size]);
+                if (start > 0) {
+                    os.munmap(unaligned[0..start]);
+                }
+                if (start + size < unaligned.len) {
+                    os.munmap(@alignCast(mem.page_size, unaligned[start + size ..]));
+                }
+
+                // Only a hint, the range still works with regular pages if this fails.
+                _ = os.linux.madvise(reserved.ptr, reserved.len, os.linux.MADV.HUGEPAGE);
+                self.reserved = reserved;
+            } else |err| {
+                std.log.warn("VirtualChunkAllocator: Failed to reserve {} bytes, falling back to child allocator: {}", .{ size, err });
+            }
+        }
+
+        return self;
+    }
+
+    pub fn deinit(self: *VirtualChunkAllocator) void {
+        if (self.reserved) |reserved| {
+            os.munmap(reserved);
+        }
+        self.* = undefined;
+    }
+
+    pub fn allocator(self: *VirtualChunkAllocator) Allocator {
+        return Allocator.init(self, alloc, resize, free);
+    }
+
+    /// Returns true if buf was allocated from the reserved range.
+    fn owns(self: *const VirtualChunkAllocator, buf: []u8) bool {
+        const reserved = self.reserved orelse return false;
+        const addr = @ptrToInt(buf.ptr);
+        return addr >= @ptrToInt(reserved.ptr) and addr < @ptrToInt(reserved.ptr) + reserved.len;
+    }
+
+    fn commit(self: *VirtualChunkAllocator, reserved: []align(mem.page_size) u8, end_index: usize) bool {
+        if (end_index <= self.committed)
+            return true;
+
+        const new_committed = std.math.min(mem.alignForward(end_index, commit_granularity), reserved.len);
+        const pages = @alignCast(mem.page_size, reserved[self.committed..new_committed]);
+        os.mprotect(pages, os.PROT.READ | os.PROT.WRITE) catch return false;
+        self.committed = new_committed;
+        return true;
+    }
+
+    fn alloc(self: *VirtualChunkAllocator, n: usize, ptr_align: u29, len_align: u29, ra: usize) ![]u8 {
+        if (self.reserved) |reserved| {
+            if (ptr_align <= mem.page_size) {
+                const start_index = mem.alignForward(self.end_index, ptr_align);
+                const end_index = start_index + n;
+                if (end_index <= reserved.len and self.commit(reserved, end_index)) {
+                    self.end_index = end_index;
+                    return reserved[start_index..end_index];
+                }
+            }
+        }
+
+        return self.child_allocator.rawAlloc(n, ptr_align, len_align, ra);
+    }
+
+    fn resize(self: *VirtualChunkAllocator, buf: []u8, buf_align: u29, new_len: usize, len_align: u29, ret_addr: usize) ?usize {
+        if (!self.owns(buf)) {
+            return self.child_allocator.rawResize(buf, buf_align, new_len, len_align, ret_addr);
+        }
+
+        if (new_len <= buf.len) {
+            return new_len;
+        }
+
+        // Only the latest allocation can grow in place.
+        const reserved = self.reserved.?;
+        const start_index = @ptrToInt(buf.ptr) - @ptrToInt(reserved.ptr);
+        if (start_index + buf.len != self.end_index or start_index + new_len > reserved.len or !self.commit(reserved, start_index + new_len)) {
+            return null;
+        }
+
+        self.end_index = start_index + new_len;
+        return new_len;
+    }
+
+    fn free(self: *VirtualChunkAllocator, buf: []u8, buf_align: u29, ret_addr: usize) void {
+        if (!self.owns(buf)) {
+            return self.child_allocator.rawFree(buf, buf_align, ret_addr);
+        }
+
+        const reserved = self.reserved.?;
+        const start_index = @ptrToInt(buf.ptr) - @ptrToInt(reserved.ptr);
+        if (start_index + buf.len == self.end_index) {
+            self.end_index = start_index;
+        }
+    }
+};